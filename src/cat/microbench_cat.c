@@ -0,0 +1,115 @@
+/**
+ * @file microbench_cat.c
+ * @brief Микробенчмарки внутренних функций s21_cat
+ *
+ * Исходник утилиты подключается целиком, чтобы замерять статические функции
+ * без изменения их видимости; main утилиты переименовывается.
+ */
+#define main s21_cat_main
+#include "s21_cat.c"
+#undef main
+
+#include "../common/microbench.h"
+
+/**
+ * @brief Данные для ядер cat
+ */
+typedef struct {
+  char *text;       ///< Сгенерированный текст
+  size_t size;      ///< Размер текста
+  CatOptions opts;  ///< Настройки для ядра
+  char *scratch;    ///< Буфер для is_binary_file
+} CatBench;
+
+/**
+ * @brief Ядро: разбиение на строки и вывод (cat_file)
+ * @param ctx данные ядра
+ */
+static void bench_cat_file(void *ctx) {
+  CatBench *bench = ctx;
+  FILE *fp = fmemopen(bench->text, bench->size, "r");
+  if (fp) {
+    cat_file(fp, &bench->opts);
+    fclose(fp);
+  }
+  return;
+}
+
+/**
+ * @brief Ядро: экранирование символов (print_escaped, -v -T -E)
+ * @param ctx данные ядра
+ */
+static void bench_print_escaped(void *ctx) {
+  CatBench *bench = ctx;
+  for (size_t i = 0; i < bench->size; i++) {
+    print_escaped(bench->text[i], &bench->opts);
+  }
+  return;
+}
+
+/**
+ * @brief Ядро: вывод строки с поиском особых байтов (print_line_content)
+ * @param ctx данные ядра
+ */
+static void bench_line_content(void *ctx) {
+  CatBench *bench = ctx;
+  print_line_content(bench->text, bench->size, &bench->opts);
+  return;
+}
+
+/**
+ * @brief Ядро: подсчет '\n' (simd_count_byte, индекс строк)
+ * @param ctx данные ядра
+ */
+static void bench_count_newlines(void *ctx) {
+  CatBench *bench = ctx;
+  volatile size_t lines = simd_count_byte(bench->text, bench->size, '\n');
+  (void)lines;
+  return;
+}
+
+/**
+ * @brief Ядро: поиск '\0' в начале файла (is_binary_file)
+ * @param ctx данные ядра
+ */
+static void bench_is_binary(void *ctx) {
+  CatBench *bench = ctx;
+  FILE *fp = fmemopen(bench->text, bench->size, "r");
+  if (fp) {
+    is_binary_file(bench->scratch, bench->size, fp, &bench->opts,
+                   set_cat_binary_flag, "bench", "microbench_cat", stderr);
+    fclose(fp);
+  }
+  return;
+}
+
+int main(int argc, char **argv) {
+  int status = 1;
+  CatBench plain = {0};
+  CatBench escaped = {0};
+  plain.size = escaped.size = BENCH_INPUT_SIZE;
+  plain.text = escaped.text = bench_generate_text(BENCH_INPUT_SIZE, 21);
+  plain.scratch = malloc(BENCH_INPUT_SIZE);
+  escaped.opts.show_tabs = escaped.opts.show_ends = 1;
+  escaped.opts.enable_v = 1;
+
+  if (argc > 1 && argv[1][0] == '-') {
+    status = bench_tool(argc, argv, "s21_cat");
+  } else if (plain.text && plain.scratch) {
+    size_t lines = simd_count_byte(plain.text, plain.size, '\n');
+    BenchCase cases[] = {
+        {"cat_file", bench_cat_file, &plain, plain.size, lines},
+        {"print_escaped", bench_print_escaped, &escaped, escaped.size,
+         escaped.size},
+        {"print_line_content", bench_line_content, &escaped, escaped.size,
+         1},
+        {"count_newlines", bench_count_newlines, &plain, plain.size, lines},
+        {"is_binary_file", bench_is_binary, &plain, plain.size, 1}};
+    status = bench_suite("s21_cat", argc > 1 ? argv[1] : "unknown", cases,
+                         sizeof(cases) / sizeof(cases[0]));
+  }
+
+  free(plain.text);
+  free(plain.scratch);
+  return status;
+}
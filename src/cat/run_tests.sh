@@ -93,6 +93,122 @@ run_test "no_newline" "$TEST_DATA_DIR/no_newline.txt"
 run_test "unicode_case" "$TEST_DATA_DIR/unicode.txt"
 run_test "binary_data" "$TEST_DATA_DIR/binary_data.bin"
 
+######################################### Уровни SIMD ##############################################
+# Строки разной длины сдвигают управляющие байты относительно границ векторов
+for i in $(seq 1 300); do
+    printf '%*s' $((i % 131)) | tr ' ' 'x'
+    printf '\t\001\033\037\177 line %d\n' $i
+done > $TEST_DATA_DIR/simd_mix.txt
+sed 's/line/\o200\o237\o240\o377/' $TEST_DATA_DIR/simd_mix.txt > $TEST_DATA_DIR/simd_high.txt
+{ printf '%*s' 700 | tr ' ' 'a'; printf '\0\001binary\n'; } > $TEST_DATA_DIR/simd_binary.bin
+run_simd_test() {
+    local test_name=$1
+    local cat_args="$2"
+    local level
+    cat $cat_args > "$EXPECTED_DIR/${test_name}_expected.txt" 2>&1 || true
+    for level in scalar sse2 avx2 avx512; do
+        echo -n "Running ${test_name}_$level..."
+        S21_SIMD=$level ./cat $cat_args > "$OUTPUT_DIR/${test_name}_${level}_output.txt" 2>&1 || true
+        diff -u "$EXPECTED_DIR/${test_name}_expected.txt" "$OUTPUT_DIR/${test_name}_${level}_output.txt" || exit 1
+        echo -e "\033[32mOK!\033[0m"
+    done
+}
+run_simd_test "simd_et" "-et $TEST_DATA_DIR/simd_mix.txt"
+run_simd_test "simd_e" "-e $TEST_DATA_DIR/simd_mix.txt"
+run_simd_test "simd_t" "-t $TEST_DATA_DIR/simd_mix.txt"
+run_simd_test "simd_binary" "$TEST_DATA_DIR/simd_binary.bin"
+# Байты 128-255 выводятся не так, как в GNU cat (как и в исходной версии),
+# поэтому векторные уровни сравниваются со scalar
+echo -n "Running simd_high..."
+S21_SIMD=scalar ./cat -et $TEST_DATA_DIR/simd_high.txt > "$EXPECTED_DIR/simd_high_expected.txt" 2>&1 || true
+for level in sse2 avx2 avx512; do
+    S21_SIMD=$level ./cat -et $TEST_DATA_DIR/simd_high.txt > "$OUTPUT_DIR/simd_high_${level}_output.txt" 2>&1 || true
+    diff -u "$EXPECTED_DIR/simd_high_expected.txt" "$OUTPUT_DIR/simd_high_${level}_output.txt" || exit 1
+done
+echo -e "\033[32mOK!\033[0m"
+
+######################################### Конвейер стандартного ввода ##############################
+echo -n "Running stdin_pipeline..."
+cat $TEST_DATA_DIR/file1.txt $TEST_DATA_DIR/file2.txt | cat -n > "$EXPECTED_DIR/stdin_pipeline_expected.txt" 2>&1 || true
+cat $TEST_DATA_DIR/file1.txt $TEST_DATA_DIR/file2.txt | S21_PIPELINE=1 ./cat -n > "$OUTPUT_DIR/stdin_pipeline_output.txt" 2>&1 || true
+diff -u "$EXPECTED_DIR/stdin_pipeline_expected.txt" "$OUTPUT_DIR/stdin_pipeline_output.txt" || exit 1
+echo -e "\033[32mOK!\033[0m"
+
+######################################### Диапазон строк (--lines) ##################################
+seq -f "line %g of the range test" 1 200000 > $TEST_DATA_DIR/lines_big.txt
+export S21_CAT_INDEX_DIR=$TEST_DATA_DIR/index_cache
+rm -rf $S21_CAT_INDEX_DIR
+rm -f $TEST_DATA_DIR/lines_big.txt.lidx
+run_range_test() {
+    local test_name=$1
+    local flags="$2"
+    local range=$3
+    local first=${range%-*}
+    local last=${range#*-}
+    echo -n "Running $test_name..."
+    cat $flags $TEST_DATA_DIR/empty_lines.txt $TEST_DATA_DIR/lines_big.txt | sed -n "${first},${last:-\$}p" > "$EXPECTED_DIR/${test_name}_expected.txt"
+    ./cat $flags --lines "$range" $TEST_DATA_DIR/empty_lines.txt $TEST_DATA_DIR/lines_big.txt > "$OUTPUT_DIR/${test_name}_output.txt" 2>&1 || true
+    diff -u "$EXPECTED_DIR/${test_name}_expected.txt" "$OUTPUT_DIR/${test_name}_output.txt" || exit 1
+    echo -e "\033[32mOK!\033[0m"
+}
+run_range_test "lines_build_index" "-n" "150000-150010"
+run_range_test "lines_with_index" "-n" "123456-123460"
+run_range_test "lines_to_end" "-E" "199990-"
+run_range_test "lines_across_files" "-b" "3-12"
+run_range_test "lines_squeeze" "-s -n" "4-9"
+ls $S21_CAT_INDEX_DIR/s21_cat-*.lidx > /dev/null || exit 1
+ls $TEST_DATA_DIR/*.lidx > /dev/null 2>&1 && exit 1
+# Отметка за концом файла: индекс отвергается и строится заново
+printf '\377\377\377\377\377\377\377\177' | dd of=$(ls $S21_CAT_INDEX_DIR/s21_cat-*.lidx) bs=1 seek=64 conv=notrunc 2> /dev/null
+run_range_test "lines_bad_index" "-n" "123456-123460"
+# Файл от 1 до 4 МБ читается конвейером в память, но индекс строится по его fd
+seq -f "mid line %g" 1 150000 > $TEST_DATA_DIR/lines_mid.txt
+echo -n "Running lines_in_memory..."
+cat -n $TEST_DATA_DIR/file1.txt $TEST_DATA_DIR/lines_mid.txt | sed -n "100000,100005p" > "$EXPECTED_DIR/lines_in_memory_expected.txt"
+./cat -n --lines 100000-100005 $TEST_DATA_DIR/file1.txt $TEST_DATA_DIR/lines_mid.txt > "$OUTPUT_DIR/lines_in_memory_output.txt" 2>&1 || true
+diff -u "$EXPECTED_DIR/lines_in_memory_expected.txt" "$OUTPUT_DIR/lines_in_memory_output.txt" || exit 1
+[ "$(ls $S21_CAT_INDEX_DIR | wc -l)" -eq 2 ] || exit 1
+echo -e "\033[32mOK!\033[0m"
+
+######################################### Разреженные файлы ########################################
+printf 'HDR\0\0binary\n' > $TEST_DATA_DIR/sparse.img
+truncate -s 64M $TEST_DATA_DIR/sparse.img
+printf 'middle data\n' >> $TEST_DATA_DIR/sparse.img
+truncate -s 128M $TEST_DATA_DIR/sparse.img
+run_sparse_test() {
+    local test_name=$1
+    local target=$2
+    echo -n "Running $test_name..."
+    cat $TEST_DATA_DIR/file1.txt $TEST_DATA_DIR/sparse.img $TEST_DATA_DIR/file2.txt > "$EXPECTED_DIR/${test_name}_expected.img"
+    rm -f "$OUTPUT_DIR/${test_name}_output.img"
+    if [ "$target" = "overwrite" ]; then
+        # Выход без O_TRUNC: старые данные под дырами должны стать нулями
+        head -c 1048576 /dev/zero | tr '\0' X > "$OUTPUT_DIR/${test_name}_output.img"
+        ./cat $TEST_DATA_DIR/file1.txt $TEST_DATA_DIR/sparse.img $TEST_DATA_DIR/file2.txt 1<> "$OUTPUT_DIR/${test_name}_output.img"
+    elif [ "$target" = "pipe" ]; then
+        ./cat $TEST_DATA_DIR/file1.txt $TEST_DATA_DIR/sparse.img $TEST_DATA_DIR/file2.txt | cat > "$OUTPUT_DIR/${test_name}_output.img"
+    else
+        ./cat $TEST_DATA_DIR/file1.txt $TEST_DATA_DIR/sparse.img $TEST_DATA_DIR/file2.txt > "$OUTPUT_DIR/${test_name}_output.img"
+    fi
+    cmp "$EXPECTED_DIR/${test_name}_expected.img" "$OUTPUT_DIR/${test_name}_output.img" || exit 1
+    echo -e "\033[32mOK!\033[0m"
+}
+run_sparse_test "sparse_to_file" "file"
+run_sparse_test "sparse_to_pipe" "pipe"
+run_sparse_test "sparse_overwrite" "overwrite"
+[ "$(du -k $OUTPUT_DIR/sparse_to_file_output.img | cut -f1)" -lt 1024 ] || exit 1
+# Файл от 1 до 4 МБ читается конвейером в память, но копируется по экстентам
+echo -n "Running sparse_in_memory..."
+printf 'HDR\0\0binary\n' > $TEST_DATA_DIR/sparse_mid.img
+truncate -s 3M $TEST_DATA_DIR/sparse_mid.img
+cat $TEST_DATA_DIR/file1.txt $TEST_DATA_DIR/sparse_mid.img > "$EXPECTED_DIR/sparse_in_memory_expected.img"
+rm -f "$OUTPUT_DIR/sparse_in_memory_output.img"
+./cat $TEST_DATA_DIR/file1.txt $TEST_DATA_DIR/sparse_mid.img > "$OUTPUT_DIR/sparse_in_memory_output.img"
+cmp "$EXPECTED_DIR/sparse_in_memory_expected.img" "$OUTPUT_DIR/sparse_in_memory_output.img" || exit 1
+[ "$(du -k $OUTPUT_DIR/sparse_in_memory_output.img | cut -f1)" -lt 1024 ] || exit 1
+echo -e "\033[32mOK!\033[0m"
+rm -f $EXPECTED_DIR/*.img $OUTPUT_DIR/*.img
+
 echo -e "\n"
 ######################################### Тест на стиль ###########################################
 echo -n "Running clang-format check..."
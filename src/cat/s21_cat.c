@@ -1,7 +1,6 @@
 #include "s21_cat.h"
 
 int main(int argc, char **argv) {
-  setlocale(LC_ALL, "");
   CatOptions opts = {0};
   ErrorCode status = SUCCESS;
   opts.program_name = basename(argv[0]);
@@ -20,9 +19,24 @@ int main(int argc, char **argv) {
 
 static ErrorCode process_files(int argc, char **argv, CatOptions *opts) {
   ErrorCode status = SUCCESS;
-  for (int i = optind; i < argc && status == SUCCESS; i++) {
-    status = process_file(argv[i], opts);
+  AsyncReader reader;
+  AsyncFile *file = NULL;
+  async_reader_open(&reader, argv + optind, argc - optind);
+  while (status == SUCCESS && !range_done(opts) &&
+         async_reader_next(&reader, &file)) {
+    FILE *fp = file->data ? fmemopen(file->data, file->size, "rb") : NULL;
+    if (fp) {
+      status = process_stream(fp, file->fd, file->filename, opts);
+      fclose(fp);
+    } else if (file->error) {
+      print_error(opts->program_name, file->filename,
+                  "No such file or directory");
+    } else {
+      status = process_file(file->filename, opts);
+    }
+    async_reader_release(&reader);
   }
+  async_reader_close(&reader);
   return (optind == argc) ? process_file("(standard input)", opts) : status;
 }
 
@@ -38,6 +52,14 @@ static ErrorCode process_long_args(int *argc, char ***argv, CatOptions *opts) {
         opts->number_all = 1;
       } else if (strcmp(opt, "squeeze-blank") == 0) {
         opts->squeeze_blank = 1;
+      } else if (strncmp(opt, "lines=", 6) == 0) {
+        status = parse_line_range(opt + 6, opts);
+      } else if (strcmp(opt, "lines") == 0 && i + 1 < *argc) {
+        status = parse_line_range((*argv)[++i], opts);
+      } else if (strcmp(opt, "lines") == 0) {
+        fprintf(stderr, "%s: option '--lines' requires an argument\n",
+                opts->program_name);
+        status = PARSE_FAILURE;
       } else {
         fprintf(stderr, "%s: unrecognized option '%s'\n", opts->program_name,
                 (*argv)[i]);
@@ -53,6 +75,27 @@ static ErrorCode process_long_args(int *argc, char ***argv, CatOptions *opts) {
   return status;
 }
 
+static ErrorCode parse_line_range(const char *arg, CatOptions *opts) {
+  ErrorCode status = SUCCESS;
+  char *end = NULL;
+  if (isdigit((unsigned char)arg[0])) {
+    opts->first_line = strtoul(arg, &end, 10);
+    opts->last_line = opts->first_line;
+    if (*end == '-' && isdigit((unsigned char)end[1])) {
+      opts->last_line = strtoul(end + 1, &end, 10);
+    } else if (*end == '-' && end[1] == '\0') {
+      opts->last_line = 0;
+      end++;
+    }
+  }
+  if (!end || *end || !opts->first_line ||
+      (opts->last_line && opts->last_line < opts->first_line)) {
+    fprintf(stderr, "%s: invalid line range '%s'\n", opts->program_name, arg);
+    status = PARSE_FAILURE;
+  }
+  return status;
+}
+
 static ErrorCode process_short_args(int argc, char **argv, CatOptions *opts) {
   ErrorCode status = SUCCESS;
   int opt;
@@ -100,34 +143,90 @@ static ErrorCode process_short_args(int argc, char **argv, CatOptions *opts) {
 static ErrorCode process_file(const char *filename, CatOptions *opts) {
   ErrorCode status = SUCCESS;
   FILE *fp = NULL;
+  PipeReader pipe = {0};
 
   if (strcmp(filename, "(standard input)") == 0) {
-    fp = stdin;
+    if (pipe_reader_enabled(STDIN_FILENO)) {
+      fp = pipe_reader_open(&pipe, STDIN_FILENO);
+    }
+    if (!fp) fp = stdin;
   } else {
     fp = fopen(filename, "rb");
   }
 
   if (fp) {
-    processing_binary(fp, opts, filename);
-    status = cat_file(fp, opts);
-    if (fp != stdin) fclose(fp);
+    status = process_stream(fp, fileno(fp), filename, opts);
+    if (pipe.stream) {
+      pipe_reader_close(&pipe);
+    } else if (fp != stdin) {
+      fclose(fp);
+    }
   } else {
     print_error(opts->program_name, filename, "No such file or directory");
   }
   return status;
 }
 
-static void processing_binary(FILE *fp, CatOptions *opts,
+static ErrorCode process_stream(FILE *fp, int fd, const char *filename,
+                                CatOptions *opts) {
+  opts->binary_file = 0;
+  if (opts->first_line) {
+    range_seek(fp, fd, opts);
+  } else if (fseek(fp, 0, SEEK_CUR) == 0) {
+    processing_binary(fp, fd, opts, filename);
+  }
+  return cat_file(fp, opts);
+}
+
+static void range_seek(FILE *fp, int fd, CatOptions *opts) {
+  LineIndex index;
+  unsigned long skip = opts->first_line - 1 > opts->input_line
+                           ? opts->first_line - 1 - opts->input_line
+                           : 0;
+  if (skip >= LINE_INDEX_STRIDE && !opts->number_nonblank &&
+      !opts->squeeze_blank && line_index_open(&index, fd)) {
+    uint64_t sample = skip / LINE_INDEX_STRIDE;
+    if (sample >= index.header.num_samples) {
+      sample = index.header.num_samples - 1;
+    }
+    if (fseeko(fp, index.offsets[sample], SEEK_SET) == 0) {
+      opts->input_line += sample * LINE_INDEX_STRIDE;
+      if (opts->number_all) opts->line_number += sample * LINE_INDEX_STRIDE;
+    }
+    line_index_free(&index);
+  }
+  return;
+}
+
+static int line_selected(const CatOptions *opts) {
+  return !opts->first_line || (opts->input_line + 1 >= opts->first_line &&
+                               !range_done(opts));
+}
+
+static int range_done(const CatOptions *opts) {
+  return opts->last_line && opts->input_line >= opts->last_line;
+}
+
+static void processing_binary(FILE *fp, int fd, CatOptions *opts,
                               const char *filename) {
   size_t size = 1024;
   char buf[size];
   is_binary_file(buf, size, fp, opts, set_cat_binary_flag, filename,
-                 opts->program_name);
+                 opts->program_name, stderr);
 
   if (opts->binary_file) {
-    size_t bytes;
-    while ((bytes = fread(buf, 1, sizeof(buf), fp)) > 0) {
-      fwrite(buf, 1, bytes, stdout);
+    int copied = 0;
+    fflush(stdout);
+    if (sparse_copy(fd, STDOUT_FILENO, ftello(fp), &copied) != SUCCESS) {
+      print_error(opts->program_name, filename, "Error copy_file_range");
+    }
+    if (copied) {
+      fseeko(fp, 0, SEEK_END);
+    } else {
+      size_t bytes;
+      while ((bytes = fread(buf, 1, sizeof(buf), fp)) > 0) {
+        fwrite(buf, 1, bytes, stdout);
+      }
     }
 
     if (ferror(fp)) {
@@ -149,7 +248,7 @@ static void print_escaped(int c, const CatOptions *opts) {
     printf("$\n");
   } else if (c == '\n') {
     putchar('\n');
-  } else if (opts->enable_v && !isprint(c) && c != '\t') {
+  } else if (opts->enable_v && !is_printable_byte(c) && c != '\t') {
     handle_non_printable(c);
   } else {
     putchar(c);
@@ -157,6 +256,8 @@ static void print_escaped(int c, const CatOptions *opts) {
   return;
 }
 
+static int is_printable_byte(int c) { return c >= 32 && c < 127; }
+
 static void handle_non_printable(int c) {
   if (c == 127) {
     printf("^?");
@@ -170,20 +271,28 @@ static void handle_non_printable(int c) {
 
 static void process_line(CatOptions *opts, const char *line, size_t len) {
   const int is_empty = (len == 1 && line[0] == '\n');
+  const int selected = line_selected(opts);
 
   if (!(opts->squeeze_blank && is_empty && opts->prev_empty)) {
-    handle_line_numbering(opts, is_empty);
-    print_line_content(line, len, opts);
+    handle_line_numbering(opts, is_empty, selected);
+    if (selected) {
+      print_line_content(line, len, opts);
+    } else {
+      opts->new_line = (line[len - 1] == '\n');
+    }
 
     opts->prev_empty = is_empty;
+    opts->input_line += (line[len - 1] == '\n');
   }
 
   return;
 }
 
-static void handle_line_numbering(CatOptions *opts, int is_empty) {
+static void handle_line_numbering(CatOptions *opts, int is_empty,
+                                  int selected) {
   if (opts->new_line && should_number_line(opts, is_empty)) {
-    printf("%6u\t", ++opts->line_number);
+    ++opts->line_number;
+    if (selected) printf("%6u\t", opts->line_number);
     opts->new_line = 0;
   }
 }
@@ -194,10 +303,17 @@ static int should_number_line(const CatOptions *opts, int is_empty) {
 }
 
 static void print_line_content(const char *line, size_t len, CatOptions *opts) {
-  for (size_t i = 0; i < len; i++) {
-    print_escaped(line[i], opts);
-    opts->new_line = (line[i] == '\n');
+  const char *p = line;
+  const char *end = line + len;
+  int plain = !opts->show_tabs && !opts->show_ends && !opts->enable_v;
+  while (p < end) {
+    const char *special = plain ? NULL : simd_find_special(p, end - p);
+    const char *run_end = special ? special : end;
+    fwrite(p, 1, run_end - p, stdout);
+    if (special) print_escaped(*special, opts);
+    p = special ? special + 1 : end;
   }
+  if (len) opts->new_line = (line[len - 1] == '\n');
   return;
 }
 
@@ -210,8 +326,8 @@ static ErrorCode cat_file(FILE *fp, CatOptions *opts) {
   int start_string = 0;
   int done_string = 0;
 
-  while (fgets(buffer, sizeof(buffer), fp) && (len = strlen(buffer)) &&
-         !done_string) {
+  while (!range_done(opts) && fgets(buffer, sizeof(buffer), fp) &&
+         (len = strlen(buffer)) && !done_string) {
     process_line(opts, buffer, len);
 
     if (buffer[len - 1] != '\n') {
@@ -3,15 +3,19 @@
 
 #include <ctype.h>
 #include <libgen.h>
-#include <locale.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
+#include "../common/async_reader.h"
 #include "../common/error.h"
 #include "../common/error_codes.h"
 #include "../common/is_binary_file.h"
+#include "../common/line_index.h"
+#include "../common/pipe_reader.h"
+#include "../common/simd.h"
+#include "../common/sparse_copy.h"
 
 #define MAX_LINE_LEN 4096
 
@@ -27,6 +31,9 @@ typedef struct {
   int new_line;              ///< Флаг начала новой строки
   const char *program_name;  ///< Имя программы
   int binary_file;           ///< Флаг бинарного файла
+  unsigned long first_line;  ///< --lines: первая строка (0 - без диапазона)
+  unsigned long last_line;   ///< --lines: последняя строка (0 - до конца)
+  unsigned long input_line;  ///< Прочитано строк (без сжатых -s)
 } CatOptions;
 
 /**
@@ -38,6 +45,14 @@ typedef struct {
  */
 static ErrorCode process_long_args(int *argc, char ***argv, CatOptions *opts);
 
+/**
+ * @brief Разбор диапазона строк --lines (N-M, N- или N)
+ * @param arg Значение опции
+ * @param opts Структура настроек
+ * @return Код ошибки
+ */
+static ErrorCode parse_line_range(const char *arg, CatOptions *opts);
+
 /**
  * @brief Разбор POSIX аргументов командной строки
  * @param argc Количество аргументов
@@ -49,6 +64,9 @@ static ErrorCode process_short_args(int argc, char **argv, CatOptions *opts);
 
 /**
  * @brief Обработка всех файлов
+ *
+ * Файлы открываются и читаются заранее через io_uring (см. async_reader.h)
+ * и выводятся из памяти в порядке аргументов.
  * @param argc Количество аргументов
  * @param argv Массив аргументов
  * @param opts Структура настроек
@@ -64,13 +82,60 @@ static ErrorCode process_files(int argc, char **argv, CatOptions *opts);
  */
 static ErrorCode process_file(const char *filename, CatOptions *opts);
 
+/**
+ * @brief Обработка открытого потока
+ *
+ * Проверка на бинарный файл перечитывает начало потока, поэтому для
+ * потоков без позиционирования (каналы, конвейер чтения) она пропускается.
+ * @param fp указатель на файл
+ * @param fd дескриптор файла (для потока fmemopen - дескриптор из
+ * конвейера чтения) или -1
+ * @param filename Имя файла
+ * @param opts Структура настроек
+ * @return Код ошибки
+ */
+static ErrorCode process_stream(FILE *fp, int fd, const char *filename,
+                                CatOptions *opts);
+
+/**
+ * @brief Переход к отметке индекса перед первой строкой диапазона
+ *
+ * Для обычных файлов от LINE_INDEX_MIN_SIZE байт используется индекс
+ * переводов строк (см. line_index.h), и номера строк -n продолжаются с
+ * номера отметки. С -b и -s номер и сжатие зависят от предыдущих строк,
+ * поэтому файл читается с начала.
+ * @param fp указатель на файл
+ * @param fd дескриптор файла для построения индекса или -1
+ * @param opts Структура настроек
+ */
+static void range_seek(FILE *fp, int fd, CatOptions *opts);
+
+/**
+ * @brief Проверяет, попадает ли текущая строка в диапазон --lines
+ * @param opts Структура настроек
+ * @return 1(true) или 0(false)
+ */
+static int line_selected(const CatOptions *opts);
+
+/**
+ * @brief Проверяет, выведена ли последняя строка диапазона --lines
+ * @param opts Структура настроек
+ * @return 1(true) или 0(false)
+ */
+static int range_done(const CatOptions *opts);
+
 /**
  * @brief Обработка бинарного файла
+ *
+ * Обычный файл копируется по экстентам данных (sparse_copy), остальные
+ * потоки - через fread/fwrite.
  * @param fp указатель на файл
+ * @param fd дескриптор файла для sparse_copy или -1
  * @param opts Структура настроек
  * @param filename Имя файла
  */
-static void processing_binary(FILE *fp, CatOptions *opts, const char *filename);
+static void processing_binary(FILE *fp, int fd, CatOptions *opts,
+                              const char *filename);
 
 /**
  * @brief установка флага: бинарный файл (Callback)
@@ -86,6 +151,16 @@ void set_cat_binary_flag(void *opts, int value);
  */
 static void print_escaped(int c, const CatOptions *opts);
 
+/**
+ * @brief Побайтовая замена isprint, не зависящая от локали
+ *
+ * Байты строки передаются как char, поэтому байты >= 128 отрицательны и,
+ * как и в isprint для UTF-8 локали, считаются непечатаемыми.
+ * @param c Обрабатываемый символ
+ * @return 1(true) или 0(false)
+ */
+static int is_printable_byte(int c);
+
 /**
  * @brief Обработка непечатаемых символов
  * @param c Обрабатываемый символ
@@ -104,8 +179,10 @@ static void process_line(CatOptions *opts, const char *line, size_t len);
  * @brief Управление нумерацией строк
  * @param opts Структура настроек
  * @param is_empty Флаг пустой строки
+ * @param selected Строка выводится (иначе номер только учитывается)
  */
-static void handle_line_numbering(CatOptions *opts, int is_empty);
+static void handle_line_numbering(CatOptions *opts, int is_empty,
+                                  int selected);
 
 /**
  * @brief Определение необходимости нумерации
@@ -0,0 +1,427 @@
+#include "aho_corasick.h"
+
+/**
+ * @brief Бор шаблонов на этапе построения
+ */
+typedef struct {
+  uint32_t *child;        ///< Первый потомок (0 - нет)
+  uint32_t *sibling;      ///< Следующий брат (0 - нет)
+  unsigned char *label;   ///< Метка перехода в состояние
+  unsigned char *output;  ///< Флаг конца шаблона
+  uint32_t count;         ///< Количество состояний
+  uint32_t capacity;      ///< Емкость массивов
+} AcTrie;
+
+/**
+ * @brief Добавляет состояние в бор
+ * @param trie бор
+ * @param label метка перехода
+ * @return номер состояния или 0 при ошибке памяти
+ */
+static uint32_t trie_new_state(AcTrie *trie, unsigned char label) {
+  uint32_t state = 0;
+  int ok = 1;
+  if (trie->count == trie->capacity) {
+    uint32_t capacity = trie->capacity ? trie->capacity * 2 : 1024;
+    uint32_t *child = realloc(trie->child, capacity * sizeof(uint32_t));
+    if (child) trie->child = child;
+    uint32_t *sibling = realloc(trie->sibling, capacity * sizeof(uint32_t));
+    if (sibling) trie->sibling = sibling;
+    unsigned char *lab = realloc(trie->label, capacity);
+    if (lab) trie->label = lab;
+    unsigned char *output = realloc(trie->output, capacity);
+    if (output) trie->output = output;
+    ok = (child && sibling && lab && output);
+    if (ok) trie->capacity = capacity;
+  }
+  if (ok) {
+    state = trie->count++;
+    trie->child[state] = 0;
+    trie->sibling[state] = 0;
+    trie->label[state] = label;
+    trie->output[state] = 0;
+  }
+  return state;
+}
+
+/**
+ * @brief Находит или создает переход, сохраняя порядок меток
+ * @param trie бор
+ * @param state исходное состояние
+ * @param c метка перехода
+ * @return целевое состояние или 0 при ошибке памяти
+ */
+static uint32_t trie_step(AcTrie *trie, uint32_t state, unsigned char c) {
+  uint32_t prev = 0;
+  uint32_t next = trie->child[state];
+  while (next && trie->label[next] < c) {
+    prev = next;
+    next = trie->sibling[next];
+  }
+  if (!next || trie->label[next] != c) {
+    uint32_t created = trie_new_state(trie, c);
+    if (created) {
+      trie->sibling[created] = next;
+      if (prev) {
+        trie->sibling[prev] = created;
+      } else {
+        trie->child[state] = created;
+      }
+    }
+    next = created;
+  }
+  return next;
+}
+
+/**
+ * @brief Строит бор по всем шаблонам
+ * @param trie бор
+ * @param store шаблоны
+ * @param fold таблица свертки регистра
+ * @return Код ошибки
+ */
+static ErrorCode trie_fill(AcTrie *trie, const PatternStore *store,
+                           const unsigned char *fold) {
+  ErrorCode status = SUCCESS;
+  trie_new_state(trie, 0);
+  if (!trie->count) status = MEMORY_ERROR;
+  for (size_t i = 0; i < store->count && status == SUCCESS; i++) {
+    const unsigned char *p =
+        (const unsigned char *)pattern_store_get(store, i);
+    uint32_t state = 0;
+    for (size_t j = 0; j < store->lengths[i] && status == SUCCESS; j++) {
+      state = trie_step(trie, state, fold[p[j]]);
+      if (!state) status = MEMORY_ERROR;
+    }
+    if (status == SUCCESS) trie->output[state] = 1;
+  }
+  return status;
+}
+
+/**
+ * @brief Размечает массивы автомата внутри блока
+ * @param ac автомат
+ * @param block блок памяти
+ * @param num_states количество состояний
+ * @param num_edges количество переходов
+ */
+static void ac_attach(AcAutomaton *ac, void *block, uint32_t num_states,
+                      uint32_t num_edges) {
+  ac->header = block;
+  ac->root_next = (uint32_t *)(ac->header + 1);
+  ac->first_edge = ac->root_next + AC_ALPHABET;
+  ac->fail = ac->first_edge + num_states + 1;
+  ac->targets = ac->fail + num_states;
+  ac->labels = (unsigned char *)(ac->targets + num_edges);
+  ac->output = ac->labels + num_edges;
+  ac->block = block;
+  return;
+}
+
+/**
+ * @brief Размер блока автомата
+ * @param num_states количество состояний
+ * @param num_edges количество переходов
+ * @return размер в байтах
+ */
+static size_t ac_block_size(uint32_t num_states, uint32_t num_edges) {
+  return sizeof(AcHeader) +
+         (AC_ALPHABET + 2 * (size_t)num_states + 1 + num_edges) *
+             sizeof(uint32_t) +
+         num_edges + num_states;
+}
+
+/**
+ * @brief Переход автомата без учета суффиксных ссылок
+ * @param ac автомат
+ * @param state состояние
+ * @param c байт
+ * @return целевое состояние или 0, если перехода нет
+ */
+static uint32_t ac_goto(const AcAutomaton *ac, uint32_t state,
+                        unsigned char c) {
+  uint32_t target = 0;
+  if (state == 0) {
+    target = ac->root_next[c];
+  } else {
+    uint32_t lo = ac->first_edge[state];
+    uint32_t hi = ac->first_edge[state + 1];
+    while (lo < hi && !target) {
+      uint32_t mid = lo + (hi - lo) / 2;
+      if (ac->labels[mid] == c) {
+        target = ac->targets[mid];
+      } else if (ac->labels[mid] < c) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+  }
+  return target;
+}
+
+/**
+ * @brief Переносит бор в плоские массивы (CSR)
+ * @param ac автомат
+ * @param trie бор
+ */
+static void ac_flatten(AcAutomaton *ac, const AcTrie *trie) {
+  uint32_t edge = 0;
+  memset(ac->root_next, 0, AC_ALPHABET * sizeof(uint32_t));
+  for (uint32_t s = 0; s < trie->count; s++) {
+    ac->first_edge[s] = edge;
+    ac->output[s] = trie->output[s];
+    for (uint32_t c = trie->child[s]; c; c = trie->sibling[c]) {
+      ac->labels[edge] = trie->label[c];
+      ac->targets[edge++] = c;
+      if (s == 0) ac->root_next[trie->label[c]] = c;
+    }
+  }
+  ac->first_edge[trie->count] = edge;
+  return;
+}
+
+/**
+ * @brief Вычисляет суффиксные ссылки обходом в ширину
+ * @param ac автомат
+ * @param queue очередь на num_states элементов
+ */
+static void ac_link_fail(AcAutomaton *ac, uint32_t *queue) {
+  size_t head = 0;
+  size_t tail = 0;
+  ac->fail[0] = 0;
+  queue[tail++] = 0;
+  while (head < tail) {
+    uint32_t u = queue[head++];
+    for (uint32_t e = ac->first_edge[u]; e < ac->first_edge[u + 1]; e++) {
+      uint32_t v = ac->targets[e];
+      uint32_t f = ac->fail[u];
+      while (u && f && !ac_goto(ac, f, ac->labels[e])) f = ac->fail[f];
+      uint32_t g = u ? ac_goto(ac, f, ac->labels[e]) : 0;
+      ac->fail[v] = (g != v) ? g : 0;
+      ac->output[v] |= ac->output[ac->fail[v]];
+      queue[tail++] = v;
+    }
+  }
+  return;
+}
+
+ErrorCode ac_build(AcAutomaton *ac, const PatternStore *store,
+                   const unsigned char *fold, uint64_t key) {
+  AcTrie trie = {0};
+  ErrorCode status = trie_fill(&trie, store, fold);
+  uint32_t *queue = NULL;
+  memset(ac, 0, sizeof(*ac));
+
+  if (status == SUCCESS) {
+    size_t size = ac_block_size(trie.count, trie.count - 1);
+    void *block = malloc(size);
+    queue = malloc(trie.count * sizeof(uint32_t));
+    if (!block || !queue) {
+      free(block);
+      status = MEMORY_ERROR;
+    } else {
+      ac_attach(ac, block, trie.count, trie.count - 1);
+      ac->block_size = size;
+      *ac->header = (AcHeader){AC_MAGIC, AC_VERSION, key, trie.count,
+                               trie.count - 1};
+      ac_flatten(ac, &trie);
+      ac_link_fail(ac, queue);
+    }
+  }
+
+  free(queue);
+  free(trie.child);
+  free(trie.sibling);
+  free(trie.label);
+  free(trie.output);
+  return status;
+}
+
+/**
+ * @brief Переход автомата с учетом суффиксных ссылок
+ * @param ac автомат
+ * @param state состояние
+ * @param c байт после свертки регистра
+ * @return новое состояние
+ */
+static uint32_t ac_step(const AcAutomaton *ac, uint32_t state,
+                        unsigned char c) {
+  uint32_t next = ac_goto(ac, state, c);
+  while (state && !next) {
+    state = ac->fail[state];
+    next = ac_goto(ac, state, c);
+  }
+  return next;
+}
+
+int ac_match(const AcAutomaton *ac, const char *text,
+             const unsigned char *fold) {
+  const unsigned char *p = (const unsigned char *)text;
+  uint32_t state = 0;
+  int found = ac->output[0];
+  for (; *p && !found; p++) {
+    state = ac_step(ac, state, fold[*p]);
+    found = ac->output[state];
+  }
+  return found;
+}
+
+ErrorCode ac_set_routes(AcAutomaton *ac, const PatternStore *store,
+                        const uint64_t *pattern_routes,
+                        const unsigned char *fold) {
+  ErrorCode status = SUCCESS;
+  uint32_t num_states = ac->header->num_states;
+  uint64_t *own = calloc(num_states, sizeof(uint64_t));
+  free(ac->routes);
+  ac->routes = calloc(num_states, sizeof(uint64_t));
+  if (!own || !ac->routes) {
+    free(ac->routes);
+    ac->routes = NULL;
+    status = MEMORY_ERROR;
+  } else {
+    for (size_t i = 0; i < store->count; i++) {
+      const unsigned char *p =
+          (const unsigned char *)pattern_store_get(store, i);
+      uint32_t state = 0;
+      for (size_t j = 0; j < store->lengths[i]; j++) {
+        state = ac_goto(ac, state, fold[p[j]]);
+      }
+      own[state] |= pattern_routes[i];
+    }
+    for (uint32_t s = 0; s < num_states; s++) {
+      for (uint32_t t = s; t; t = ac->fail[t]) ac->routes[s] |= own[t];
+      ac->routes[s] |= own[0];
+    }
+  }
+  free(own);
+  return status;
+}
+
+uint64_t ac_match_routes(const AcAutomaton *ac, const char *text,
+                         const unsigned char *fold, uint64_t all) {
+  const unsigned char *p = (const unsigned char *)text;
+  uint32_t state = 0;
+  uint64_t mask = ac->routes[0];
+  for (; *p && mask != all; p++) {
+    state = ac_step(ac, state, fold[*p]);
+    if (ac->output[state]) mask |= ac->routes[state];
+  }
+  return mask;
+}
+
+size_t ac_count_lines(const AcAutomaton *ac, const char *text, size_t len,
+                      const unsigned char *fold) {
+  const unsigned char *p = (const unsigned char *)text;
+  const unsigned char *end = p + len;
+  size_t count = 0;
+  while (p < end) {
+    uint32_t state = 0;
+    int found = ac->output[0];
+    for (; p < end && *p != '\n' && *p && !found; p++) {
+      state = ac_step(ac, state, fold[*p]);
+      found = ac->output[state];
+    }
+    count += found;
+    const unsigned char *newline = memchr(p, '\n', end - p);
+    p = newline ? newline + 1 : end;
+  }
+  return count;
+}
+
+size_t ac_feed(const AcAutomaton *ac, uint32_t *state, const char *text,
+               size_t len, const unsigned char *fold) {
+  const unsigned char *p = (const unsigned char *)text;
+  uint32_t current = *state;
+  size_t i = 0;
+  for (; i < len && p[i] && !ac->output[current]; i++) {
+    current = ac_step(ac, current, fold[p[i]]);
+  }
+  *state = current;
+  return i;
+}
+
+ErrorCode ac_save(const AcAutomaton *ac, const char *path) {
+  ErrorCode status = FILE_ERROR;
+  char tmp_path[4096 + 32];
+  FILE *fp = cache_create(path, tmp_path, sizeof(tmp_path));
+  if (fp) {
+    size_t written = fwrite(ac->block, 1, ac->block_size, fp);
+    status = cache_commit(fp, tmp_path, path, written == ac->block_size);
+  }
+  return status;
+}
+
+/**
+ * @brief Проверяет, что каждый шаблон проходится по бору загруженного
+ * автомата и кончается в состоянии с флагом совпадения
+ *
+ * Каждый шаг проверяет границы переходов состояния и номер цели, поэтому
+ * обход не выходит за блок автомата.
+ * @param ac автомат из файла кэша
+ * @param store шаблоны
+ * @param fold таблица свертки регистра
+ * @return 1 если все шаблоны найдены, иначе 0
+ */
+static int ac_check_patterns(const AcAutomaton *ac, const PatternStore *store,
+                             const unsigned char *fold) {
+  uint32_t num_states = ac->header->num_states;
+  uint32_t num_edges = ac->header->num_edges;
+  int valid = ac->first_edge[num_states] == num_edges;
+  for (size_t i = 0; i < store->count && valid; i++) {
+    const unsigned char *p =
+        (const unsigned char *)pattern_store_get(store, i);
+    uint32_t state = 0;
+    for (size_t j = 0; j < store->lengths[i] && valid; j++) {
+      valid = (state == 0 ||
+               (ac->first_edge[state] <= ac->first_edge[state + 1] &&
+                ac->first_edge[state + 1] <= num_edges));
+      if (valid) state = ac_goto(ac, state, fold[p[j]]);
+      valid = valid && state > 0 && state < num_states;
+    }
+    valid = valid && ac->output[state];
+  }
+  return valid;
+}
+
+int ac_load(AcAutomaton *ac, const char *path, uint64_t key,
+            const PatternStore *store, const unsigned char *fold) {
+  int loaded = 0;
+  struct stat st;
+  int fd = cache_open(path, &st);
+  memset(ac, 0, sizeof(*ac));
+  if (fd >= 0 && (size_t)st.st_size >= sizeof(AcHeader)) {
+    void *block = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (block != MAP_FAILED) {
+      const AcHeader *header = block;
+      loaded = (header->magic == AC_MAGIC && header->version == AC_VERSION &&
+                header->key == key && header->num_states > 0 &&
+                header->num_edges == header->num_states - 1 &&
+                ac_block_size(header->num_states, header->num_edges) ==
+                    (size_t)st.st_size);
+      if (loaded) {
+        ac_attach(ac, block, header->num_states, header->num_edges);
+        ac->block_size = st.st_size;
+        ac->mapped = 1;
+        loaded = ac_check_patterns(ac, store, fold);
+      }
+      if (!loaded) {
+        munmap(block, st.st_size);
+        memset(ac, 0, sizeof(*ac));
+      }
+    }
+  }
+  if (fd >= 0) close(fd);
+  return loaded;
+}
+
+void ac_free(AcAutomaton *ac) {
+  free(ac->routes);
+  if (ac->mapped) {
+    munmap(ac->block, ac->block_size);
+  } else {
+    free(ac->block);
+  }
+  memset(ac, 0, sizeof(*ac));
+  return;
+}
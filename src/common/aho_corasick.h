@@ -0,0 +1,170 @@
+#ifndef AHO_CORASICK_H
+#define AHO_CORASICK_H
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cache_file.h"
+#include "error_codes.h"
+#include "pattern_store.h"
+
+#define AC_MAGIC 0x31324341U  ///< Сигнатура файла кэша ("AC21")
+#define AC_VERSION 1U         ///< Версия формата файла кэша
+#define AC_ALPHABET 256       ///< Размер алфавита (байты)
+
+/**
+ * @brief Заголовок сериализованного автомата
+ */
+typedef struct {
+  uint32_t magic;       ///< AC_MAGIC
+  uint32_t version;     ///< AC_VERSION
+  uint64_t key;         ///< Хеш шаблонов и флагов
+  uint32_t num_states;  ///< Количество состояний
+  uint32_t num_edges;   ///< Количество переходов
+} AcHeader;
+
+/**
+ * @brief Автомат Ахо-Корасик в плоском представлении
+ *
+ * Все массивы лежат в одном блоке памяти сразу за заголовком, поэтому
+ * блок можно записать в файл и затем отобразить в память через mmap.
+ */
+typedef struct {
+  AcHeader *header;       ///< Заголовок
+  uint32_t *root_next;    ///< Переходы корня по всем байтам
+  uint32_t *first_edge;   ///< Начало переходов состояния (CSR)
+  uint32_t *fail;         ///< Суффиксные ссылки
+  uint32_t *targets;      ///< Цели переходов
+  unsigned char *labels;  ///< Метки переходов (по возрастанию)
+  unsigned char *output;  ///< Флаг: в состоянии кончается шаблон
+  uint64_t *routes;       ///< Маски маршрутов состояний (NULL - нет)
+  void *block;            ///< Блок памяти автомата
+  size_t block_size;      ///< Размер блока
+  int mapped;             ///< Блок получен через mmap
+} AcAutomaton;
+
+/**
+ * @brief Строит автомат по набору шаблонов
+ * @param ac автомат
+ * @param store шаблоны
+ * @param fold таблица свертки регистра
+ * @param key ключ кэша, записываемый в заголовок
+ * @return Код ошибки
+ */
+ErrorCode ac_build(AcAutomaton *ac, const PatternStore *store,
+                   const unsigned char *fold, uint64_t key);
+
+/**
+ * @brief Проверяет, содержит ли строка хотя бы один шаблон
+ * @param ac автомат
+ * @param text строка, завершенная '\0'
+ * @param fold таблица свертки регистра
+ * @return 1(true) или 0(false)
+ */
+int ac_match(const AcAutomaton *ac, const char *text,
+             const unsigned char *fold);
+
+/**
+ * @brief Назначает шаблонам маски маршрутов (s21_grep --route)
+ *
+ * Маска состояния объединяет маски всех шаблонов, кончающихся в нем или в
+ * состояниях его цепочки суффиксных ссылок. Маски хранятся вне блока
+ * автомата и не попадают в файл кэша.
+ * @param ac автомат, построенный по store
+ * @param store шаблоны
+ * @param pattern_routes маска маршрутов каждого шаблона
+ * @param fold таблица свертки регистра
+ * @return Код ошибки
+ */
+ErrorCode ac_set_routes(AcAutomaton *ac, const PatternStore *store,
+                        const uint64_t *pattern_routes,
+                        const unsigned char *fold);
+
+/**
+ * @brief Собирает маршруты, шаблоны которых встречаются в строке
+ *
+ * Строка проходится один раз; просмотр прекращается, когда собраны все
+ * маршруты из all.
+ * @param ac автомат с масками маршрутов
+ * @param text строка, завершенная '\0'
+ * @param fold таблица свертки регистра
+ * @param all маска всех маршрутов
+ * @return маска совпавших маршрутов
+ */
+uint64_t ac_match_routes(const AcAutomaton *ac, const char *text,
+                         const unsigned char *fold, uint64_t all);
+
+/**
+ * @brief Считает строки буфера, содержащие хотя бы один шаблон
+ *
+ * Строки разделяются '\n'; последняя строка может не иметь '\n'. Как и в
+ * ac_match, часть строки после байта '\0' не просматривается.
+ * @param ac автомат
+ * @param text буфер
+ * @param len длина буфера
+ * @param fold таблица свертки регистра
+ * @return количество совпавших строк
+ */
+size_t ac_count_lines(const AcAutomaton *ac, const char *text, size_t len,
+                      const unsigned char *fold);
+
+/**
+ * @brief Продолжает сопоставление строки, поданной частями
+ *
+ * Состояние переносится между вызовами, поэтому строку любой длины можно
+ * просматривать окнами фиксированного размера. Просмотр останавливается на
+ * первом совпадении (ac->output[*state] != 0) или на байте '\0'.
+ * @param ac автомат
+ * @param state состояние (0 - начало строки), обновляется
+ * @param text очередная часть строки без '\n'
+ * @param len длина части
+ * @param fold таблица свертки регистра
+ * @return количество просмотренных байт
+ */
+size_t ac_feed(const AcAutomaton *ac, uint32_t *state, const char *text,
+               size_t len, const unsigned char *fold);
+
+/**
+ * @brief Атомарно сохраняет автомат в файл
+ *
+ * Файл создается через cache_create (mkstemp, права 0600) и rename.
+ * @param ac автомат
+ * @param path путь к файлу кэша
+ * @return Код ошибки
+ */
+ErrorCode ac_save(const AcAutomaton *ac, const char *path);
+
+/**
+ * @brief Загружает автомат из файла кэша
+ *
+ * Файл отображается в память готовым к работе, без обхода всех состояний.
+ * Доверие к содержимому основано на cache_open: файл принадлежит текущему
+ * пользователю, недоступен для записи другим и появляется только через
+ * rename полностью записанного временного файла. Дополнительно проверяются
+ * заголовок, размер и то, что каждый шаблон проходится по бору до
+ * состояния с флагом совпадения (O(суммарной длины шаблонов)). Суффиксные
+ * ссылки не проверяются: файл, испорченный самим владельцем, может
+ * нарушить поиск, а его усечение во время работы - привести к SIGBUS.
+ * @param ac автомат
+ * @param path путь к файлу кэша
+ * @param key ожидаемый ключ
+ * @param store шаблоны, по которым построен кэш
+ * @param fold таблица свертки регистра
+ * @return 1 если кэш подходит и загружен, иначе 0
+ */
+int ac_load(AcAutomaton *ac, const char *path, uint64_t key,
+            const PatternStore *store, const unsigned char *fold);
+
+/**
+ * @brief Освобождает автомат
+ * @param ac автомат
+ */
+void ac_free(AcAutomaton *ac);
+
+#endif  // AHO_CORASICK_H
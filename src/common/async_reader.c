@@ -0,0 +1,468 @@
+#include "async_reader.h"
+
+#include <errno.h>
+#include <stdint.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define ASYNC_HAVE_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+/**
+ * @brief Завершает работу с файлом
+ *
+ * Дескриптор прочитанного файла остается открытым до
+ * async_reader_release; при ошибке или откладывании он закрывается.
+ * @param file файл
+ * @param fallback отложить файл для блокирующего чтения
+ */
+static void finish_file(AsyncFile *file, int fallback) {
+  if (fallback || file->error) {
+    if (file->fd >= 0) close(file->fd);
+    file->fd = -1;
+    free(file->data);
+    file->data = NULL;
+    file->size = 0;
+  }
+  file->fallback = fallback;
+  file->state = ASYNC_DONE;
+  return;
+}
+
+#ifdef ASYNC_HAVE_URING
+#define ASYNC_PROBE_OPS 256  ///< Размер таблицы операций для probe
+
+/**
+ * @brief Отображенные кольца io_uring
+ */
+typedef struct {
+  int fd;                     ///< Дескриптор io_uring
+  unsigned *sq_head;          ///< Голова очереди отправки
+  unsigned *sq_tail;          ///< Хвост очереди отправки
+  unsigned *sq_mask;          ///< Маска очереди отправки
+  unsigned sq_entries;        ///< Размер очереди отправки
+  unsigned *sq_array;         ///< Индексы SQE
+  struct io_uring_sqe *sqes;  ///< Массив SQE
+  unsigned *cq_head;          ///< Голова очереди завершений
+  unsigned *cq_tail;          ///< Хвост очереди завершений
+  unsigned *cq_mask;          ///< Маска очереди завершений
+  struct io_uring_cqe *cqes;  ///< Массив CQE
+  void *sq_ptr;               ///< Отображение очереди отправки
+  size_t sq_size;             ///< Размер отображения очереди отправки
+  void *cq_ptr;               ///< Отображение очереди завершений
+  size_t cq_size;             ///< Размер отображения очереди завершений
+  size_t sqes_size;           ///< Размер отображения SQE
+} AsyncRing;
+
+/**
+ * @brief Отображает кольца созданного io_uring
+ * @param ring кольца
+ * @param p параметры, заполненные io_uring_setup
+ * @return 1 при успехе, иначе 0
+ */
+static int ring_map(AsyncRing *ring, const struct io_uring_params *p) {
+  ring->sq_size = p->sq_off.array + p->sq_entries * sizeof(unsigned);
+  ring->cq_size = p->cq_off.cqes + p->cq_entries * sizeof(struct io_uring_cqe);
+  if (p->features & IORING_FEAT_SINGLE_MMAP) {
+    if (ring->cq_size > ring->sq_size) ring->sq_size = ring->cq_size;
+    ring->cq_size = 0;
+  }
+  ring->sq_ptr = mmap(NULL, ring->sq_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+  ring->cq_ptr = ring->sq_ptr;
+  if (ring->sq_ptr != MAP_FAILED && ring->cq_size) {
+    ring->cq_ptr = mmap(NULL, ring->cq_size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ring->fd,
+                        IORING_OFF_CQ_RING);
+  }
+  ring->sqes_size = p->sq_entries * sizeof(struct io_uring_sqe);
+  ring->sqes = ring->cq_ptr == MAP_FAILED || ring->sq_ptr == MAP_FAILED
+                   ? MAP_FAILED
+                   : mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, ring->fd,
+                          IORING_OFF_SQES);
+  return ring->sqes != MAP_FAILED;
+}
+
+/**
+ * @brief Освобождает кольца io_uring
+ * @param ring кольца
+ */
+static void ring_free(AsyncRing *ring) {
+  if (ring->sqes && ring->sqes != MAP_FAILED) {
+    munmap(ring->sqes, ring->sqes_size);
+  }
+  if (ring->cq_size && ring->cq_ptr && ring->cq_ptr != MAP_FAILED) {
+    munmap(ring->cq_ptr, ring->cq_size);
+  }
+  if (ring->sq_ptr && ring->sq_ptr != MAP_FAILED) {
+    munmap(ring->sq_ptr, ring->sq_size);
+  }
+  if (ring->fd >= 0) close(ring->fd);
+  free(ring);
+  return;
+}
+
+/**
+ * @brief Проверяет, что ядро поддерживает IORING_OP_OPENAT и IORING_OP_READ
+ *
+ * io_uring_setup появился раньше этих операций (до 5.6), поэтому наличие
+ * кольца само по себе не означает, что через него можно читать файлы.
+ * @param ring кольца
+ * @return 1 если операции поддерживаются, иначе 0
+ */
+static int ring_probe(const AsyncRing *ring) {
+  size_t size = sizeof(struct io_uring_probe) +
+                ASYNC_PROBE_OPS * sizeof(struct io_uring_probe_op);
+  struct io_uring_probe *probe = calloc(1, size);
+  int supported = 0;
+  if (probe && syscall(__NR_io_uring_register, ring->fd,
+                       IORING_REGISTER_PROBE, probe, ASYNC_PROBE_OPS) == 0) {
+    supported = probe->last_op >= IORING_OP_OPENAT &&
+                probe->last_op >= IORING_OP_READ &&
+                (probe->ops[IORING_OP_OPENAT].flags & IO_URING_OP_SUPPORTED) &&
+                (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED);
+  }
+  free(probe);
+  return supported;
+}
+
+/**
+ * @brief Создает io_uring
+ * @param entries размер очереди
+ * @return кольца или NULL, если io_uring недоступен
+ */
+static AsyncRing *ring_setup(unsigned entries) {
+  struct io_uring_params p = {0};
+  AsyncRing *ring = calloc(1, sizeof(AsyncRing));
+  if (ring) {
+    ring->fd = syscall(__NR_io_uring_setup, entries, &p);
+    if (ring->fd >= 0 && ring_map(ring, &p) && ring_probe(ring)) {
+      char *sq = ring->sq_ptr;
+      char *cq = ring->cq_ptr;
+      ring->sq_head = (unsigned *)(sq + p.sq_off.head);
+      ring->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+      ring->sq_entries = p.sq_entries;
+      ring->sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+      ring->sq_array = (unsigned *)(sq + p.sq_off.array);
+      ring->cq_head = (unsigned *)(cq + p.cq_off.head);
+      ring->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+      ring->cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+      ring->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    } else {
+      ring_free(ring);
+      ring = NULL;
+    }
+  }
+  return ring;
+}
+
+/**
+ * @brief Подготавливает SQE в очереди отправки
+ *
+ * После ошибки io_uring_enter SQE больше не отправляются, поэтому и не
+ * подготавливаются; хвост очереди не обгоняет голову больше чем на размер
+ * очереди.
+ * @param reader конвейер
+ * @param opcode операция
+ * @param index номер файла (user_data)
+ * @return подготовленный SQE или NULL, если очередь полна или сломана
+ */
+static struct io_uring_sqe *ring_get_sqe(AsyncReader *reader, int opcode,
+                                         int index) {
+  AsyncRing *ring = reader->ring;
+  unsigned tail = *ring->sq_tail;
+  unsigned head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+  struct io_uring_sqe *sqe = NULL;
+  if (!reader->broken && tail - head < ring->sq_entries) {
+    unsigned slot = tail & *ring->sq_mask;
+    sqe = &ring->sqes[slot];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->user_data = (unsigned long long)index;
+    ring->sq_array[slot] = slot;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    reader->pending++;
+  }
+  return sqe;
+}
+
+/**
+ * @brief Ставит в очередь openat для файла (или откладывает файл)
+ * @param reader конвейер
+ * @param index номер файла
+ */
+static void submit_open(AsyncReader *reader, int index) {
+  AsyncFile *file = &reader->slots[index % reader->depth];
+  struct io_uring_sqe *sqe = ring_get_sqe(reader, IORING_OP_OPENAT, index);
+  if (sqe) {
+    sqe->fd = AT_FDCWD;
+    sqe->addr = (unsigned long long)(uintptr_t)file->filename;
+    sqe->open_flags = O_RDONLY | O_CLOEXEC;
+    file->state = ASYNC_OPENING;
+  } else {
+    finish_file(file, 1);
+  }
+  return;
+}
+
+/**
+ * @brief Ставит в очередь чтение в свободную часть буфера (или
+ * откладывает файл)
+ * @param reader конвейер
+ * @param index номер файла
+ */
+static void submit_read(AsyncReader *reader, int index) {
+  AsyncFile *file = &reader->slots[index % reader->depth];
+  struct io_uring_sqe *sqe = ring_get_sqe(reader, IORING_OP_READ, index);
+  if (sqe) {
+    sqe->fd = file->fd;
+    sqe->addr = (unsigned long long)(uintptr_t)(file->data + file->size);
+    sqe->len = file->capacity - file->size;
+    sqe->off = file->size;
+    file->state = ASYNC_READING;
+  } else {
+    finish_file(file, 1);
+  }
+  return;
+}
+
+/**
+ * @brief Проверяет, что операция отвергнута ядром как неподдерживаемая
+ * @param res отрицательный результат операции
+ * @return 1(true) или 0(false)
+ */
+static int is_unsupported(int res) {
+  return res == -EINVAL || res == -EOPNOTSUPP;
+}
+
+/**
+ * @brief Обрабатывает завершение openat: выделяет буфер и начинает чтение
+ * @param reader конвейер
+ * @param index номер файла
+ * @param res результат openat
+ */
+static void on_opened(AsyncReader *reader, int index, int res) {
+  AsyncFile *file = &reader->slots[index % reader->depth];
+  struct stat st;
+  if (res < 0) {
+    file->error = is_unsupported(res) ? 0 : -res;
+    finish_file(file, is_unsupported(res));
+  } else {
+    file->fd = res;
+    int eligible = (fstat(file->fd, &st) == 0 && S_ISREG(st.st_mode) &&
+                    st.st_size > 0 && st.st_size <= ASYNC_MAX_FILE);
+    file->capacity = eligible ? (size_t)st.st_size + 1 : 0;
+    file->data = eligible ? malloc(file->capacity) : NULL;
+    if (file->data) {
+      submit_read(reader, index);
+    } else {
+      finish_file(file, 1);
+    }
+  }
+  return;
+}
+
+/**
+ * @brief Обрабатывает завершение read: продолжает чтение или завершает файл
+ * @param reader конвейер
+ * @param index номер файла
+ * @param res результат read
+ */
+static void on_read(AsyncReader *reader, int index, int res) {
+  AsyncFile *file = &reader->slots[index % reader->depth];
+  if (res < 0) {
+    file->error = is_unsupported(res) ? 0 : -res;
+    finish_file(file, is_unsupported(res));
+  } else {
+    file->size += res;
+    if (file->size < file->capacity) {
+      finish_file(file, 0);
+    } else if (file->capacity * 2 > ASYNC_MAX_FILE) {
+      finish_file(file, 1);
+    } else {
+      char *data = realloc(file->data, file->capacity * 2);
+      if (data) {
+        file->data = data;
+        file->capacity *= 2;
+        submit_read(reader, index);
+      } else {
+        finish_file(file, 1);
+      }
+    }
+  }
+  return;
+}
+
+/**
+ * @brief Разбирает очередь завершений
+ * @param reader конвейер
+ */
+static void reap_completions(AsyncReader *reader) {
+  AsyncRing *ring = reader->ring;
+  unsigned head = *ring->cq_head;
+  while (head != __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+    const struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+    int index = (int)cqe->user_data;
+    if (reader->slots[index % reader->depth].state == ASYNC_OPENING) {
+      on_opened(reader, index, cqe->res);
+    } else {
+      on_read(reader, index, cqe->res);
+    }
+    head++;
+  }
+  __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+  return;
+}
+
+/**
+ * @brief Отправляет подготовленные SQE и ждет завершений
+ * @param reader конвейер
+ * @param min_complete минимальное количество завершений
+ */
+static void ring_enter(AsyncReader *reader, unsigned min_complete) {
+  AsyncRing *ring = reader->ring;
+  int rc = syscall(__NR_io_uring_enter, ring->fd, reader->pending,
+                   min_complete, min_complete ? IORING_ENTER_GETEVENTS : 0,
+                   NULL, 0);
+  if (rc >= 0) {
+    reader->pending -= (unsigned)rc < reader->pending ? (unsigned)rc
+                                                       : reader->pending;
+  } else if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+    reader->broken = 1;
+  }
+  return;
+}
+#else
+typedef struct AsyncRing AsyncRing;
+
+static AsyncRing *ring_setup(unsigned entries) {
+  (void)entries;
+  return NULL;
+}
+
+static void ring_free(AsyncRing *ring) { (void)ring; }
+
+static void submit_open(AsyncReader *reader, int index) {
+  (void)reader;
+  (void)index;
+}
+
+static void reap_completions(AsyncReader *reader) { (void)reader; }
+
+static void ring_enter(AsyncReader *reader, unsigned min_complete) {
+  (void)min_complete;
+  reader->broken = 1;
+}
+#endif
+
+/**
+ * @brief Проверяет, что имя обозначает стандартный ввод
+ * @param filename имя файла
+ * @return 1(true) или 0(false)
+ */
+static int is_stdin_name(const char *filename) {
+  return strcmp(filename, "-") == 0 ||
+         strcmp(filename, "(standard input)") == 0;
+}
+
+/**
+ * @brief Заполняет окно операциями openat
+ * @param reader конвейер
+ */
+static void fill_window(AsyncReader *reader) {
+  while (reader->next_submit < reader->num_files &&
+         reader->next_submit < reader->next_deliver + (int)reader->depth) {
+    int index = reader->next_submit++;
+    AsyncFile *file = &reader->slots[index % reader->depth];
+    *file = (AsyncFile){.filename = reader->files[index], .fd = -1};
+    if (is_stdin_name(file->filename)) {
+      finish_file(file, 1);
+    } else {
+      submit_open(reader, index);
+    }
+  }
+  return;
+}
+
+/**
+ * @brief Выдает файл для блокирующего чтения потребителем
+ * @param reader конвейер
+ * @param filename имя файла
+ * @return слот блокирующего режима
+ */
+static AsyncFile *fallback_file(AsyncReader *reader, const char *filename) {
+  reader->current = (AsyncFile){
+      .filename = filename, .fd = -1, .fallback = 1, .state = ASYNC_DONE};
+  return &reader->current;
+}
+
+void async_reader_open(AsyncReader *reader, char **files, int num_files) {
+  const char *env = getenv(ASYNC_DEPTH_ENV);
+  int depth = env ? atoi(env) : ASYNC_DEFAULT_DEPTH;
+  if (depth > ASYNC_MAX_DEPTH) depth = ASYNC_MAX_DEPTH;
+  if (depth > num_files) depth = num_files;
+
+  memset(reader, 0, sizeof(*reader));
+  reader->files = files;
+  reader->num_files = num_files;
+  if (depth > 1) {
+    reader->slots = calloc(depth, sizeof(AsyncFile));
+    reader->ring = reader->slots ? ring_setup(depth) : NULL;
+  }
+  if (reader->ring) {
+    reader->depth = depth;
+  } else {
+    free(reader->slots);
+    reader->slots = NULL;
+  }
+  return;
+}
+
+int async_reader_next(AsyncReader *reader, AsyncFile **file) {
+  int delivered = reader->next_deliver < reader->num_files;
+  if (delivered && !reader->ring) {
+    *file = fallback_file(reader, reader->files[reader->next_deliver]);
+  } else if (delivered) {
+    AsyncFile *slot = &reader->slots[reader->next_deliver % reader->depth];
+    fill_window(reader);
+    while (slot->state != ASYNC_DONE && !reader->broken) {
+      ring_enter(reader, 1);
+      reap_completions(reader);
+    }
+    if (reader->pending && !reader->broken) ring_enter(reader, 0);
+    *file = slot->state == ASYNC_DONE ? slot
+                                      : fallback_file(reader, slot->filename);
+  }
+  return delivered;
+}
+
+void async_reader_release(AsyncReader *reader) {
+  if (reader->ring) {
+    AsyncFile *slot = &reader->slots[reader->next_deliver % reader->depth];
+    if (slot->state == ASYNC_DONE) {
+      if (slot->fd >= 0) close(slot->fd);
+      free(slot->data);
+      *slot = (AsyncFile){.fd = -1};
+    }
+  }
+  reader->next_deliver++;
+  return;
+}
+
+void async_reader_close(AsyncReader *reader) {
+  if (reader->ring) {
+    ring_free(reader->ring);
+    for (unsigned i = 0; i < reader->depth; i++) {
+      if (reader->slots[i].fd >= 0) close(reader->slots[i].fd);
+      free(reader->slots[i].data);
+    }
+  }
+  free(reader->slots);
+  memset(reader, 0, sizeof(*reader));
+  return;
+}
@@ -0,0 +1,91 @@
+#ifndef ASYNC_READER_H
+#define ASYNC_READER_H
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define ASYNC_DEPTH_ENV "S21_IO_DEPTH"  ///< Глубина очереди (0 - отключить)
+#define ASYNC_DEFAULT_DEPTH 16          ///< Глубина очереди по умолчанию
+#define ASYNC_MAX_DEPTH 256             ///< Максимальная глубина очереди
+#define ASYNC_MAX_FILE (4 * 1024 * 1024)  ///< Максимальный размер в памяти
+
+/**
+ * @brief Состояние файла в конвейере чтения
+ */
+typedef enum {
+  ASYNC_EMPTY,    ///< Слот свободен
+  ASYNC_OPENING,  ///< Выполняется openat
+  ASYNC_READING,  ///< Выполняется read
+  ASYNC_DONE      ///< Файл прочитан, открыт с ошибкой или отложен
+} AsyncState;
+
+/**
+ * @brief Файл, выдаваемый конвейером
+ *
+ * Если fallback == 1, файл не был прочитан заранее (стандартный ввод,
+ * не обычный файл, пустой или слишком большой файл, io_uring недоступен),
+ * и потребитель должен открыть и прочитать его обычным способом. Для
+ * прочитанного файла fd остается открытым: поток fmemopen над data не
+ * имеет дескриптора, а индекс строк и копирование по экстентам работают
+ * с файлом через fd.
+ */
+typedef struct {
+  const char *filename;  ///< Имя файла из аргументов
+  char *data;            ///< Содержимое файла
+  size_t size;           ///< Размер содержимого
+  size_t capacity;       ///< Размер буфера
+  int fd;                ///< Дескриптор файла до async_reader_release
+  int error;             ///< errno ошибки открытия или чтения
+  int fallback;          ///< Читать обычным блокирующим способом
+  AsyncState state;      ///< Состояние
+} AsyncFile;
+
+/**
+ * @brief Конвейер асинхронного чтения файлов через io_uring
+ */
+typedef struct {
+  void *ring;         ///< Кольца io_uring (NULL - блокирующий режим)
+  AsyncFile *slots;   ///< Окно файлов в полете
+  AsyncFile current;  ///< Слот для блокирующего режима
+  unsigned depth;     ///< Размер окна
+  char **files;       ///< Имена файлов
+  int num_files;      ///< Количество файлов
+  int next_submit;    ///< Следующий файл для openat
+  int next_deliver;   ///< Следующий файл для выдачи
+  unsigned pending;   ///< Подготовленные, но не отправленные SQE
+  int broken;         ///< io_uring_enter завершился ошибкой
+} AsyncReader;
+
+/**
+ * @brief Создает конвейер; при недоступности io_uring - блокирующий режим
+ * @param reader конвейер
+ * @param files имена файлов
+ * @param num_files количество файлов
+ */
+void async_reader_open(AsyncReader *reader, char **files, int num_files);
+
+/**
+ * @brief Выдает следующий файл в порядке аргументов
+ * @param reader конвейер
+ * @param file указатель на выданный файл
+ * @return 1 если файл выдан, 0 если файлы закончились
+ */
+int async_reader_next(AsyncReader *reader, AsyncFile **file);
+
+/**
+ * @brief Освобождает выданный файл и продвигает окно
+ * @param reader конвейер
+ */
+void async_reader_release(AsyncReader *reader);
+
+/**
+ * @brief Закрывает конвейер
+ * @param reader конвейер
+ */
+void async_reader_close(AsyncReader *reader);
+
+#endif  // ASYNC_READER_H
@@ -0,0 +1,47 @@
+#include "cache_file.h"
+
+int cache_dir(const char *env, char *dir, size_t size) {
+  const char *value = getenv(env);
+  const char *home = getenv("HOME");
+  int ok = 0;
+  if (value && *value) {
+    ok = snprintf(dir, size, "%s", value) < (int)size;
+  } else if (home && *home) {
+    ok = snprintf(dir, size, "%s/.cache", home) < (int)size;
+  }
+  return ok && (mkdir(dir, 0700) == 0 || errno == EEXIST);
+}
+
+int cache_open(const char *path, struct stat *st) {
+  int fd = open(path, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+  if (fd >= 0 &&
+      (fstat(fd, st) != 0 || !S_ISREG(st->st_mode) ||
+       st->st_uid != geteuid() || (st->st_mode & (S_IWGRP | S_IWOTH)))) {
+    close(fd);
+    fd = -1;
+  }
+  return fd;
+}
+
+FILE *cache_create(const char *path, char *tmp_path, size_t size) {
+  FILE *fp = NULL;
+  if (snprintf(tmp_path, size, "%s%s", path, CACHE_TMP_SUFFIX) < (int)size) {
+    int fd = mkstemp(tmp_path);
+    if (fd >= 0) fp = fdopen(fd, "wb");
+    if (fd >= 0 && !fp) {
+      close(fd);
+      unlink(tmp_path);
+    }
+  }
+  return fp;
+}
+
+ErrorCode cache_commit(FILE *fp, const char *tmp_path, const char *path,
+                       int written) {
+  ErrorCode status = SUCCESS;
+  if (fclose(fp) != 0 || !written || rename(tmp_path, path) != 0) {
+    unlink(tmp_path);
+    status = FILE_ERROR;
+  }
+  return status;
+}
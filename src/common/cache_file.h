@@ -0,0 +1,63 @@
+#ifndef CACHE_FILE_H
+#define CACHE_FILE_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "error_codes.h"
+
+#define CACHE_TMP_SUFFIX ".XXXXXX"  ///< Шаблон mkstemp для временного файла
+
+/**
+ * @brief Определяет каталог кэша пользователя и создает его при отсутствии
+ *
+ * Каталог берется из переменной окружения env, иначе - $HOME/.cache.
+ * @param env имя переменной окружения с каталогом
+ * @param dir буфер для пути каталога
+ * @param size размер буфера
+ * @return 1 если каталог доступен, иначе 0
+ */
+int cache_dir(const char *env, char *dir, size_t size);
+
+/**
+ * @brief Открывает файл кэша для чтения, если ему можно доверять
+ *
+ * Файл должен быть обычным файлом (символические ссылки не раскрываются),
+ * принадлежать текущему пользователю (geteuid) и не быть доступным для
+ * записи группе и остальным: иначе его мог подложить другой пользователь
+ * общего каталога.
+ * @param path путь к файлу
+ * @param st сведения о файле
+ * @return дескриптор или -1
+ */
+int cache_open(const char *path, struct stat *st);
+
+/**
+ * @brief Создает временный файл рядом с path
+ *
+ * Имя выбирается mkstemp (O_CREAT | O_EXCL, права 0600), поэтому заранее
+ * созданный файл или символическая ссылка не могут быть перезаписаны.
+ * @param path путь к итоговому файлу
+ * @param tmp_path буфер для пути временного файла
+ * @param size размер буфера
+ * @return поток для записи или NULL
+ */
+FILE *cache_create(const char *path, char *tmp_path, size_t size);
+
+/**
+ * @brief Закрывает временный файл и атомарно заменяет им path
+ * @param fp поток, полученный от cache_create
+ * @param tmp_path путь временного файла
+ * @param path путь к итоговому файлу
+ * @param written 1 если все данные записаны
+ * @return Код ошибки
+ */
+ErrorCode cache_commit(FILE *fp, const char *tmp_path, const char *path,
+                       int written);
+
+#endif  // CACHE_FILE_H
@@ -2,10 +2,16 @@
 
 void print_error(const char *program_name, const char *filename,
                  const char *message) {
+  fprint_error(stderr, program_name, filename, message);
+  return;
+}
+
+void fprint_error(FILE *stream, const char *program_name, const char *filename,
+                  const char *message) {
   if (strcmp(filename, "") == 0) {
-    fprintf(stderr, "%s: %s\n", program_name, message);
+    fprintf(stream, "%s: %s\n", program_name, message);
   } else {
-    fprintf(stderr, "%s: %s: %s\n", program_name, filename, message);
+    fprintf(stream, "%s: %s: %s\n", program_name, filename, message);
   }
   return;
 }
\ No newline at end of file
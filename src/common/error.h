@@ -12,4 +12,14 @@
  */
 void print_error(const char *program_name, const char *filename,
                  const char *message);
+
+/**
+ * @brief выводит сообщение об ошибке в указанный поток
+ * @param stream поток вывода
+ * @param program_name имя программы
+ * @param filename имя файла
+ * @param message сообщение об ошибке
+ */
+void fprint_error(FILE *stream, const char *program_name, const char *filename,
+                  const char *message);
 #endif
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include <string.h>
 
 #include "error.h"
+#include "simd.h"
 
 typedef void (*set_binary_flag)(void *, int);
 
@@ -17,8 +18,10 @@ typedef void (*set_binary_flag)(void *, int);
  * @param set_flag указатель на функцию установки флага (Callback)
  * @param filename имя файла
  * @param program_name имя программы
+ * @param err поток для сообщения об ошибке чтения (в режиме сервера -
+ * stderr клиента)
  */
 void is_binary_file(char *buf, size_t size, FILE *fp, void *opts,
                     set_binary_flag set_flag, const char *filename,
-                    const char *program_name);
+                    const char *program_name, FILE *err);
 #endif
\ No newline at end of file
@@ -0,0 +1,219 @@
+#include "line_index.h"
+
+/**
+ * @brief Проверяет, что индекс соответствует файлу
+ * @param header заголовок индекса
+ * @param st сведения о файле
+ * @return 1(true) или 0(false)
+ */
+static int header_matches(const LineIndexHeader *header,
+                          const struct stat *st) {
+  return header->magic == LINE_INDEX_MAGIC &&
+         header->version == LINE_INDEX_VERSION &&
+         header->file_size == (uint64_t)st->st_size &&
+         header->mtime_sec == (int64_t)st->st_mtim.tv_sec &&
+         header->mtime_nsec == (int64_t)st->st_mtim.tv_nsec &&
+         header->stride == LINE_INDEX_STRIDE &&
+         header->newlines <= (uint64_t)st->st_size &&
+         header->num_samples == header->newlines / LINE_INDEX_STRIDE + 1;
+}
+
+/**
+ * @brief Проверяет, что отметки начинаются с нуля, строго возрастают и
+ * лежат внутри файла
+ * @param index индекс
+ * @param st сведения о файле
+ * @return 1(true) или 0(false)
+ */
+static int offsets_valid(const LineIndex *index, const struct stat *st) {
+  int valid = index->offsets[0] == 0;
+  for (uint64_t i = 1; valid && i < index->header.num_samples; i++) {
+    valid = index->offsets[i] > index->offsets[i - 1] &&
+            index->offsets[i] <= (uint64_t)st->st_size;
+  }
+  return valid;
+}
+
+/**
+ * @brief Читает индекс из файла
+ *
+ * Файл открывается через cache_open: чужой или доступный для записи
+ * другим пользователям индекс не читается.
+ * @param index индекс
+ * @param path путь к файлу индекса
+ * @param st сведения об индексируемом файле
+ * @return 1 если индекс прочитан и действителен, иначе 0
+ */
+static int index_load(LineIndex *index, const char *path,
+                      const struct stat *st) {
+  int loaded = 0;
+  struct stat cache_st;
+  int fd = cache_open(path, &cache_st);
+  FILE *fp = fd >= 0 ? fdopen(fd, "rb") : NULL;
+  if (fp && fread(&index->header, sizeof(index->header), 1, fp) == 1 &&
+      header_matches(&index->header, st) &&
+      (uint64_t)cache_st.st_size ==
+          sizeof(index->header) +
+              index->header.num_samples * sizeof(uint64_t)) {
+    size_t count = index->header.num_samples;
+    index->offsets = malloc(count * sizeof(uint64_t));
+    loaded = index->offsets &&
+             fread(index->offsets, sizeof(uint64_t), count, fp) == count &&
+             offsets_valid(index, st);
+  }
+  if (fp) {
+    fclose(fp);
+  } else if (fd >= 0) {
+    close(fd);
+  }
+  return loaded;
+}
+
+/**
+ * @brief Добавляет отметку в индекс
+ * @param index индекс
+ * @param capacity емкость массива отметок
+ * @param offset смещение начала строки
+ * @return Код ошибки
+ */
+static ErrorCode index_push(LineIndex *index, size_t *capacity,
+                            uint64_t offset) {
+  ErrorCode status = SUCCESS;
+  if (index->header.num_samples == *capacity) {
+    size_t grown = *capacity ? *capacity * 2 : 64;
+    uint64_t *offsets = realloc(index->offsets, grown * sizeof(uint64_t));
+    if (offsets) {
+      index->offsets = offsets;
+      *capacity = grown;
+    } else {
+      status = MEMORY_ERROR;
+    }
+  }
+  if (status == SUCCESS) index->offsets[index->header.num_samples++] = offset;
+  return status;
+}
+
+/**
+ * @brief Отмечает строки блока, на которые приходится шаг выборки
+ *
+ * Блоки без отметок пропускаются после подсчета '\n' словами по 8 байт;
+ * положение '\n' ищется через memchr только в блоках с отметкой.
+ * @param index индекс
+ * @param capacity емкость массива отметок
+ * @param block блок
+ * @param size размер блока
+ * @param base смещение блока в файле
+ * @return Код ошибки
+ */
+static ErrorCode index_block(LineIndex *index, size_t *capacity,
+                             const char *block, size_t size, uint64_t base) {
+  ErrorCode status = SUCCESS;
+  uint64_t *newlines = &index->header.newlines;
+  uint64_t next = index->header.num_samples * LINE_INDEX_STRIDE;
+  size_t count = simd_count_byte(block, size, '\n');
+  if (*newlines + count < next) {
+    *newlines += count;
+  } else {
+    const char *end = block + size;
+    for (const char *p = block; status == SUCCESS &&
+                                (p = memchr(p, '\n', end - p)) != NULL;) {
+      p++;
+      if (++*newlines == next) {
+        status = index_push(index, capacity, base + (p - block));
+        next += LINE_INDEX_STRIDE;
+      }
+    }
+  }
+  return status;
+}
+
+/**
+ * @brief Строит индекс, читая файл блоками
+ * @param index индекс
+ * @param fd дескриптор файла
+ * @param st сведения о файле
+ * @return Код ошибки
+ */
+static ErrorCode index_build(LineIndex *index, int fd, const struct stat *st) {
+  size_t capacity = 0;
+  char *block = malloc(LINE_INDEX_BLOCK);
+  ErrorCode status = block ? index_push(index, &capacity, 0) : MEMORY_ERROR;
+  uint64_t offset = 0;
+  ssize_t bytes = 0;
+  while (status == SUCCESS &&
+         (bytes = pread(fd, block, LINE_INDEX_BLOCK, offset)) > 0) {
+    status = index_block(index, &capacity, block, bytes, offset);
+    offset += bytes;
+  }
+  if (status == SUCCESS && (bytes < 0 || offset != (uint64_t)st->st_size)) {
+    status = FILE_ERROR;
+  }
+  index->header.magic = LINE_INDEX_MAGIC;
+  index->header.version = LINE_INDEX_VERSION;
+  index->header.file_size = st->st_size;
+  index->header.mtime_sec = st->st_mtim.tv_sec;
+  index->header.mtime_nsec = st->st_mtim.tv_nsec;
+  index->header.stride = LINE_INDEX_STRIDE;
+  free(block);
+  return status;
+}
+
+/**
+ * @brief Сохраняет индекс атомарно (временный файл и rename)
+ * @param index индекс
+ * @param path путь к файлу индекса
+ */
+static void index_save(const LineIndex *index, const char *path) {
+  char tmp_path[4096 + 32];
+  FILE *fp = cache_create(path, tmp_path, sizeof(tmp_path));
+  if (fp) {
+    size_t count = index->header.num_samples;
+    int written =
+        fwrite(&index->header, sizeof(index->header), 1, fp) == 1 &&
+        fwrite(index->offsets, sizeof(uint64_t), count, fp) == count;
+    cache_commit(fp, tmp_path, path, written);
+  }
+  return;
+}
+
+/**
+ * @brief Формирует путь к файлу индекса в каталоге кэша пользователя
+ * @param st сведения об индексируемом файле
+ * @param path буфер для пути
+ * @param size размер буфера
+ * @return 1 если путь сформирован, иначе 0
+ */
+static int index_path(const struct stat *st, char *path, size_t size) {
+  char dir[4096];
+  return cache_dir(LINE_INDEX_DIR_ENV, dir, sizeof(dir)) &&
+         snprintf(path, size, "%s/s21_cat-%llx-%llx%s", dir,
+                  (unsigned long long)st->st_dev,
+                  (unsigned long long)st->st_ino,
+                  LINE_INDEX_SUFFIX) < (int)size;
+}
+
+int line_index_open(LineIndex *index, int fd) {
+  int ready = 0;
+  struct stat st;
+  const char *env = getenv(LINE_INDEX_ENV);
+  char path[4096 + 64];
+  memset(index, 0, sizeof(*index));
+  if ((!env || strcmp(env, "0") != 0) && fd >= 0 && fstat(fd, &st) == 0 &&
+      S_ISREG(st.st_mode) && st.st_size >= LINE_INDEX_MIN_SIZE) {
+    int cached = index_path(&st, path, sizeof(path));
+    ready = cached && index_load(index, path, &st);
+    if (!ready) {
+      line_index_free(index);
+      ready = (index_build(index, fd, &st) == SUCCESS);
+      if (ready && cached) index_save(index, path);
+    }
+    if (!ready) line_index_free(index);
+  }
+  return ready;
+}
+
+void line_index_free(LineIndex *index) {
+  free(index->offsets);
+  memset(index, 0, sizeof(*index));
+  return;
+}
@@ -0,0 +1,73 @@
+#ifndef LINE_INDEX_H
+#define LINE_INDEX_H
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cache_file.h"
+#include "error_codes.h"
+#include "simd.h"
+
+#define LINE_INDEX_MAGIC 0x3158494CU       ///< Сигнатура индекса ("LIX1")
+#define LINE_INDEX_VERSION 1U              ///< Версия формата индекса
+#define LINE_INDEX_STRIDE 4096             ///< Шаг выборки: строк на отметку
+#define LINE_INDEX_MIN_SIZE (1024 * 1024)  ///< Минимальный размер файла
+#define LINE_INDEX_SUFFIX ".lidx"          ///< Суффикс файла индекса
+#define LINE_INDEX_ENV "S21_CAT_INDEX"     ///< 0 - не использовать индекс
+#define LINE_INDEX_DIR_ENV "S21_CAT_INDEX_DIR"  ///< Каталог индексов
+#define LINE_INDEX_BLOCK (1024 * 1024)     ///< Блок чтения при построении
+
+/**
+ * @brief Заголовок файла индекса
+ *
+ * Индекс действителен, пока размер и время изменения файла совпадают с
+ * сохраненными, а отметки строго возрастают и не выходят за конец файла.
+ */
+typedef struct {
+  uint32_t magic;        ///< LINE_INDEX_MAGIC
+  uint32_t version;      ///< LINE_INDEX_VERSION
+  uint64_t file_size;    ///< Размер файла
+  int64_t mtime_sec;     ///< Время изменения файла (секунды)
+  int64_t mtime_nsec;    ///< Время изменения файла (наносекунды)
+  uint64_t stride;       ///< Шаг выборки
+  uint64_t newlines;     ///< Количество символов '\n' в файле
+  uint64_t num_samples;  ///< Количество отметок
+} LineIndexHeader;
+
+/**
+ * @brief Выборочный индекс переводов строк
+ *
+ * offsets[i] - смещение начала строки с номером i * stride + 1.
+ */
+typedef struct {
+  LineIndexHeader header;  ///< Заголовок
+  uint64_t *offsets;       ///< Смещения отметок
+} LineIndex;
+
+/**
+ * @brief Загружает индекс файла или строит и сохраняет его в кэше
+ *
+ * Индекс используется только для обычных файлов от LINE_INDEX_MIN_SIZE
+ * байт. Файлы индексов хранятся в каталоге кэша пользователя
+ * ($S21_CAT_INDEX_DIR или $HOME/.cache) под именем по устройству и inode
+ * файла, поэтому cat ничего не пишет рядом с читаемыми файлами. Если файл
+ * индекса устарел, он перестраивается; если каталог кэша недоступен,
+ * построенный индекс используется без сохранения.
+ * @param index индекс
+ * @param fd дескриптор открытого файла (читается через pread)
+ * @return 1 если индекс готов, иначе 0
+ */
+int line_index_open(LineIndex *index, int fd);
+
+/**
+ * @brief Освобождает индекс
+ * @param index индекс
+ */
+void line_index_free(LineIndex *index);
+
+#endif  // LINE_INDEX_H
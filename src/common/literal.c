@@ -0,0 +1,92 @@
+#define _GNU_SOURCE
+#include "literal.h"
+
+int is_ascii_literal(const char *pattern) {
+  int literal = 1;
+  for (const unsigned char *p = (const unsigned char *)pattern; *p && literal;
+       p++) {
+    literal = (*p < 128 && !strchr("\\.[*^$", *p));
+  }
+  return literal;
+}
+
+int pattern_needs_locale(const char *pattern) {
+  int needs = 0;
+  for (const unsigned char *p = (const unsigned char *)pattern; *p && !needs;
+       p++) {
+    if (*p >= 128 || *p == '.' || *p == '[') {
+      needs = 1;
+    } else if (*p == '\\' && p[1]) {
+      p++;
+      needs = (*p >= 128 || !strchr("(){}123456789+?|.*[]^$\\", *p));
+    }
+  }
+  return needs;
+}
+
+void init_fold_table(unsigned char *table, int ignore_case) {
+  for (int c = 0; c < FOLD_TABLE_SIZE; c++) {
+    table[c] = (ignore_case && c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+  }
+  return;
+}
+
+/**
+ * @brief Сравнивает байты с учетом свертки регистра
+ * @param text текст
+ * @param needle образец
+ * @param len количество байт
+ * @param fold таблица свертки регистра
+ * @return 1 если байты совпадают
+ */
+static int fold_equal(const unsigned char *text, const unsigned char *needle,
+                      size_t len, const unsigned char *fold) {
+  size_t i = 0;
+  while (i < len && fold[text[i]] == fold[needle[i]]) i++;
+  return i == len;
+}
+
+const char *literal_search(const char *text, size_t text_len,
+                           const char *needle, size_t needle_len,
+                           const unsigned char *fold) {
+  const char *found = NULL;
+  if (!fold) {
+    found = memmem(text, text_len, needle, needle_len);
+  } else if (needle_len == 0) {
+    found = text;
+  } else if (needle_len <= text_len) {
+    const unsigned char first = fold[(unsigned char)needle[0]];
+    const unsigned char upper =
+        (first >= 'a' && first <= 'z') ? first - ('a' - 'A') : first;
+    const char *end = text + text_len - needle_len + 1;
+    const char *p = text;
+    while (p < end && !found) {
+      p = simd_find_byte2(p, end - p, first, upper);
+      if (!p) {
+        p = end;
+      } else if (fold_equal((const unsigned char *)p,
+                            (const unsigned char *)needle, needle_len, fold)) {
+        found = p;
+      } else {
+        p++;
+      }
+    }
+  }
+  return found;
+}
+
+size_t literal_count_lines(const char *text, size_t len, const char *needle,
+                           size_t needle_len, const unsigned char *fold) {
+  const char *p = text;
+  const char *end = text + len;
+  size_t count = 0;
+  while (p < end) {
+    const char *found = literal_search(p, end - p, needle, needle_len, fold);
+    const char *line = found ? memrchr(p, '\n', found - p) : NULL;
+    line = line ? line + 1 : p;
+    if (found && !memchr(line, '\0', found - line)) count++;
+    const char *newline = found ? memchr(found, '\n', end - found) : NULL;
+    p = newline ? newline + 1 : end;
+  }
+  return count;
+}
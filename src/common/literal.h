@@ -0,0 +1,66 @@
+#ifndef LITERAL_H
+#define LITERAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "simd.h"
+
+#define FOLD_TABLE_SIZE 256  ///< Размер таблицы свертки регистра
+
+/**
+ * @brief Проверяет, что шаблон BRE является ASCII литералом
+ * @param pattern шаблон
+ * @return 1(true) или 0(false)
+ */
+int is_ascii_literal(const char *pattern);
+
+/**
+ * @brief Проверяет, требует ли шаблон многобайтовой локали
+ * @param pattern шаблон
+ * @return 1(true) если шаблон содержит не-ASCII байты, '.', скобочные
+ * выражения или классы вида \w, иначе 0(false)
+ */
+int pattern_needs_locale(const char *pattern);
+
+/**
+ * @brief Заполняет таблицу свертки регистра для ASCII
+ * @param table таблица размером FOLD_TABLE_SIZE
+ * @param ignore_case флаг игнорирования регистра
+ */
+void init_fold_table(unsigned char *table, int ignore_case);
+
+/**
+ * @brief Побайтовый поиск подстроки
+ *
+ * С таблицей свертки кандидаты на первый байт ищутся через
+ * simd_find_byte2 (оба регистра сразу), затем сравнивается остаток.
+ * @param text текст
+ * @param text_len длина текста
+ * @param needle искомая подстрока
+ * @param needle_len длина подстроки
+ * @param fold таблица свертки регистра или NULL
+ * @return указатель на начало совпадения или NULL
+ */
+const char *literal_search(const char *text, size_t text_len,
+                           const char *needle, size_t needle_len,
+                           const unsigned char *fold);
+
+/**
+ * @brief Считает строки буфера, содержащие подстроку
+ *
+ * Строки разделяются '\n'; последняя строка может не иметь '\n'. Часть
+ * строки после байта '\0' не просматривается, как при поиске в строке C.
+ * Подстрока не должна содержать '\n'.
+ * @param text буфер
+ * @param len длина буфера
+ * @param needle искомая подстрока
+ * @param needle_len длина подстроки
+ * @param fold таблица свертки регистра или NULL
+ * @return количество совпавших строк
+ */
+size_t literal_count_lines(const char *text, size_t len, const char *needle,
+                           size_t needle_len, const unsigned char *fold);
+
+#endif  // LITERAL_H
@@ -0,0 +1,241 @@
+#include "microbench.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+extern char **environ;
+
+/**
+ * @brief Имена счетчиков в отчете
+ */
+static const char *const counter_names[BENCH_COUNTERS] = {
+    "cycles", "instructions", "branch_misses", "cache_misses"};
+
+void bench_counters_open(BenchCounters *counters) {
+  counters->leader = -1;
+  for (int i = 0; i < BENCH_COUNTERS; i++) counters->fds[i] = -1;
+#ifdef __linux__
+  static const uint64_t configs[BENCH_COUNTERS] = {
+      PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+      PERF_COUNT_HW_BRANCH_MISSES, PERF_COUNT_HW_CACHE_MISSES};
+  for (int i = 0; i < BENCH_COUNTERS; i++) {
+    struct perf_event_attr attr = {0};
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = configs[i];
+    attr.disabled = (counters->leader < 0);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    counters->fds[i] =
+        syscall(SYS_perf_event_open, &attr, 0, -1, counters->leader, 0);
+    if (counters->leader < 0) counters->leader = counters->fds[i];
+  }
+#endif
+  return;
+}
+
+void bench_counters_close(BenchCounters *counters) {
+  for (int i = 0; i < BENCH_COUNTERS; i++) {
+    if (counters->fds[i] >= 0) close(counters->fds[i]);
+    counters->fds[i] = -1;
+  }
+  counters->leader = -1;
+  return;
+}
+
+/**
+ * @brief Включает или выключает группу счетчиков
+ * @param counters счетчики
+ * @param enable 1 - сбросить и включить, 0 - выключить
+ */
+static void counters_toggle(const BenchCounters *counters, int enable) {
+#ifdef __linux__
+  if (counters->leader >= 0) {
+    if (enable) {
+      ioctl(counters->leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+      ioctl(counters->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    } else {
+      ioctl(counters->leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    }
+  }
+#else
+  (void)counters;
+  (void)enable;
+#endif
+  return;
+}
+
+/**
+ * @brief Текущее время в наносекундах
+ * @return монотонное время
+ */
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+char *bench_generate_text(size_t size, unsigned seed) {
+  static const char alphabet[] =
+      "abcdefghijklmnopqrstuvwxyz ABCDEFGHIJKLMNOPQRSTUVWXYZ 0123456789 .,:;";
+  char *text = malloc(size);
+  uint32_t state = seed ? seed : 1;
+  size_t line_left = 0;
+  for (size_t i = 0; text && i < size; i++) {
+    state = state * 1103515245U + 12345U;
+    uint32_t r = state >> 8;
+    if (line_left == 0) {
+      text[i] = '\n';
+      line_left = r % 120;
+    } else if (r % 64 == 0) {
+      text[i] = (r % 128 == 0) ? '\t' : (char)(1 + r % 31);
+    } else {
+      text[i] = alphabet[r % (sizeof(alphabet) - 1)];
+    }
+    line_left -= line_left ? 1 : 0;
+  }
+  return text;
+}
+
+int bench_write_corpus(const char *path, size_t size, unsigned seed) {
+  int status = 1;
+  char *text = bench_generate_text(size, seed);
+  FILE *fp = text ? fopen(path, "wb") : NULL;
+  if (fp) {
+    size_t written = fwrite(text, 1, size, fp);
+    status = (fclose(fp) != 0 || written != size);
+  }
+  if (status) fprintf(stderr, "microbench: cannot write %s\n", path);
+  free(text);
+  return status;
+}
+
+void bench_spawn(void *ctx) {
+  char *const *argv = ctx;
+  for (int i = 0; i < BENCH_STARTUP_RUNS; i++) {
+    pid_t pid;
+    if (posix_spawn(&pid, argv[0], NULL, NULL, argv, environ) == 0) {
+      waitpid(pid, NULL, 0);
+    }
+  }
+  return;
+}
+
+int bench_tool(int argc, char **argv, const char *suite) {
+  int status = 1;
+  if (argc > 2 && strcmp(argv[1], BENCH_CORPUS_FLAG) == 0) {
+    status = bench_write_corpus(argv[2], BENCH_INPUT_SIZE, 21);
+  } else if (argc > 3 && strcmp(argv[1], BENCH_STARTUP_FLAG) == 0) {
+    BenchCase startup = {"startup", bench_spawn, argv + 3, 0,
+                         BENCH_STARTUP_RUNS};
+    status = bench_suite(suite, argv[2], &startup, 1);
+  } else {
+    fprintf(stderr, "microbench: unknown mode %s\n", argv[1]);
+  }
+  return status;
+}
+
+void bench_begin(FILE *json, const char *suite, const char *rev) {
+  fprintf(json, "{\n  \"suite\": \"%s\",\n  \"rev\": \"%s\",\n", suite,
+          rev);
+  fprintf(json, "  \"simd\": \"%s\",\n", simd_level_name(simd_level()));
+  fprintf(json, "  \"cflags\": \"%s\",\n", BENCH_CFLAGS);
+  fprintf(json, "  \"iterations\": %d,\n  \"kernels\": [", BENCH_ITERATIONS);
+  return;
+}
+
+/**
+ * @brief Прогрев и BENCH_ITERATIONS замеров ядра
+ * @param counters счетчики
+ * @param bench описание замера
+ * @param values показания счетчиков самого быстрого запуска
+ * @return лучшее время одного запуска в наносекундах
+ */
+static uint64_t bench_measure(const BenchCounters *counters,
+                              const BenchCase *bench, uint64_t *values) {
+  uint64_t best = UINT64_MAX;
+  bench->run(bench->ctx);
+  for (int i = 0; i < BENCH_ITERATIONS; i++) {
+    uint64_t run_values[BENCH_COUNTERS] = {0};
+    counters_toggle(counters, 1);
+    uint64_t start = now_ns();
+    bench->run(bench->ctx);
+    uint64_t elapsed = now_ns() - start;
+    counters_toggle(counters, 0);
+    for (int j = 0; j < BENCH_COUNTERS; j++) {
+      if (counters->fds[j] >= 0 &&
+          read(counters->fds[j], &run_values[j], sizeof(uint64_t)) !=
+              sizeof(uint64_t)) {
+        run_values[j] = 0;
+      }
+    }
+    if (elapsed < best) {
+      best = elapsed;
+      memcpy(values, run_values, sizeof(run_values));
+    }
+  }
+  return best;
+}
+
+void bench_run(FILE *json, const BenchCounters *counters,
+               const BenchCase *bench, int first) {
+  uint64_t values[BENCH_COUNTERS] = {0};
+  uint64_t best = bench_measure(counters, bench, values);
+
+  fprintf(json, "%s\n    {\"name\": \"%s\", \"bytes\": %zu, \"ops\": %zu, ",
+          first ? "" : ",", bench->name, bench->bytes, bench->ops);
+  fprintf(json, "\"ns\": %llu, ", (unsigned long long)best);
+  if (bench->bytes) {
+    fprintf(json, "\"ns_per_byte\": %.4f, ", (double)best / bench->bytes);
+  } else {
+    fprintf(json, "\"ns_per_byte\": null, ");
+  }
+  if (bench->ops) {
+    fprintf(json, "\"ns_per_op\": %.2f", (double)best / bench->ops);
+  } else {
+    fprintf(json, "\"ns_per_op\": null");
+  }
+  for (int j = 0; j < BENCH_COUNTERS; j++) {
+    if (counters->fds[j] >= 0) {
+      fprintf(json, ", \"%s\": %llu", counter_names[j],
+              (unsigned long long)values[j]);
+    } else {
+      fprintf(json, ", \"%s\": null", counter_names[j]);
+    }
+  }
+  fputc('}', json);
+  return;
+}
+
+void bench_end(FILE *json) {
+  fprintf(json, "\n  ]\n}\n");
+  fflush(json);
+  return;
+}
+
+int bench_suite(const char *suite, const char *rev, const BenchCase *cases,
+                size_t num_cases) {
+  int status = 1;
+  int fd = dup(STDOUT_FILENO);
+  FILE *json = (fd >= 0) ? fdopen(fd, "w") : NULL;
+  if (json && freopen("/dev/null", "w", stdout)) {
+    BenchCounters counters;
+    bench_counters_open(&counters);
+    bench_begin(json, suite, rev);
+    for (size_t i = 0; i < num_cases; i++) {
+      bench_run(json, &counters, &cases[i], i == 0);
+    }
+    bench_end(json);
+    bench_counters_close(&counters);
+    status = 0;
+  }
+  if (json) {
+    fclose(json);
+  } else if (fd >= 0) {
+    close(fd);
+  }
+  return status;
+}
@@ -0,0 +1,146 @@
+#ifndef MICROBENCH_H
+#define MICROBENCH_H
+
+#include <spawn.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "simd.h"
+
+#define BENCH_COUNTERS 4     ///< Количество аппаратных счетчиков
+#define BENCH_ITERATIONS 15  ///< Количество замеров на ядро
+#define BENCH_CORPUS_FLAG "--corpus"  ///< Записать корпус вместо замеров
+#define BENCH_STARTUP_FLAG "--startup"  ///< Замерить запуск команды
+#define BENCH_STARTUP_RUNS 200          ///< Запусков команды за замер
+#define BENCH_INPUT_SIZE (4 * 1024 * 1024)  ///< Размер входных данных
+
+#ifndef BENCH_CFLAGS
+#define BENCH_CFLAGS "unknown"  ///< Компилятор и флаги сборки (из Makefile)
+#endif
+
+/**
+ * @brief Ядро для замера (Callback)
+ */
+typedef void (*bench_kernel)(void *ctx);
+
+/**
+ * @brief Описание замера
+ */
+typedef struct {
+  const char *name;  ///< Имя ядра в отчете
+  bench_kernel run;  ///< Функция ядра
+  void *ctx;         ///< Данные ядра
+  size_t bytes;      ///< Обработано байт за один запуск
+  size_t ops;        ///< Обработано операций (строк, вызовов) за запуск
+} BenchCase;
+
+/**
+ * @brief Группа аппаратных счетчиков perf_event_open
+ */
+typedef struct {
+  int fds[BENCH_COUNTERS];  ///< Дескрипторы счетчиков (-1 - недоступен)
+  int leader;               ///< Дескриптор лидера группы (-1 - нет)
+} BenchCounters;
+
+/**
+ * @brief Открывает счетчики cycles, instructions, branch-misses, cache-misses
+ * @param counters счетчики
+ */
+void bench_counters_open(BenchCounters *counters);
+
+/**
+ * @brief Закрывает счетчики
+ * @param counters счетчики
+ */
+void bench_counters_close(BenchCounters *counters);
+
+/**
+ * @brief Генерирует текст из строк случайной длины
+ *
+ * Строки содержат печатные символы, табуляции и управляющие байты, но не
+ * содержат '\0'. Генератор детерминирован для одинакового seed.
+ * @param size размер текста
+ * @param seed начальное значение генератора
+ * @return текст (освобождается вызывающим) или NULL
+ */
+char *bench_generate_text(size_t size, unsigned seed);
+
+/**
+ * @brief Записывает текст генератора в файл (корпус для make pgo)
+ * @param path путь к файлу
+ * @param size размер текста
+ * @param seed начальное значение генератора
+ * @return 0 при успехе, 1 при ошибке
+ */
+int bench_write_corpus(const char *path, size_t size, unsigned seed);
+
+/**
+ * @brief Ядро: BENCH_STARTUP_RUNS запусков команды (fork + exec + exit)
+ *
+ * Процесс создается posix_spawn (clone с общей памятью), поэтому
+ * копирование таблиц страниц замера не попадает в результат. Вывод
+ * команды направляется в стандартный вывод замера (/dev/null).
+ * @param ctx команда (char *const argv[], завершается NULL)
+ */
+void bench_spawn(void *ctx);
+
+/**
+ * @brief Служебные режимы программы замеров
+ *
+ * --corpus FILE записывает корпус для make pgo; --startup REV COMMAND...
+ * выводит JSON отчет с временем одного запуска команды.
+ * @param argc количество аргументов
+ * @param argv аргументы программы замеров
+ * @param suite имя набора ядер
+ * @return 0 при успехе, 1 при ошибке или неизвестном режиме
+ */
+int bench_tool(int argc, char **argv, const char *suite);
+
+/**
+ * @brief Начинает JSON отчет
+ *
+ * В отчет записываются ревизия, уровень SIMD и флаги сборки BENCH_CFLAGS.
+ * @param json поток отчета
+ * @param suite имя набора ядер
+ * @param rev ревизия исходников (например, git rev-parse --short HEAD)
+ */
+void bench_begin(FILE *json, const char *suite, const char *rev);
+
+/**
+ * @brief Выполняет замер ядра и выводит его JSON объект
+ *
+ * Время и показания счетчиков берутся из одного, самого быстрого запуска.
+ * @param json поток отчета
+ * @param counters счетчики
+ * @param bench описание замера
+ * @param first 1 для первого ядра в отчете
+ */
+void bench_run(FILE *json, const BenchCounters *counters,
+               const BenchCase *bench, int first);
+
+/**
+ * @brief Завершает JSON отчет
+ * @param json поток отчета
+ */
+void bench_end(FILE *json);
+
+/**
+ * @brief Выполняет набор замеров и печатает JSON отчет в stdout
+ *
+ * На время замеров stdout перенаправляется в /dev/null, чтобы вывод ядер
+ * не смешивался с отчетом и не зависел от терминала.
+ * @param suite имя набора ядер
+ * @param rev ревизия исходников
+ * @param cases замеры
+ * @param num_cases количество замеров
+ * @return 0 при успехе, 1 если не удалось перенаправить вывод
+ */
+int bench_suite(const char *suite, const char *rev, const BenchCase *cases,
+                size_t num_cases);
+
+#endif  // MICROBENCH_H
@@ -0,0 +1,133 @@
+#include "pattern_store.h"
+
+/**
+ * @brief Увеличивает блок памяти геометрически
+ * @param ptr указатель на блок
+ * @param capacity текущая емкость (обновляется)
+ * @param need требуемая емкость
+ * @param item размер элемента
+ * @param initial начальная емкость
+ * @return Код ошибки
+ */
+static ErrorCode grow(void **ptr, size_t *capacity, size_t need, size_t item,
+                      size_t initial) {
+  ErrorCode status = SUCCESS;
+  if (need > *capacity) {
+    size_t new_capacity = *capacity ? *capacity : initial;
+    while (new_capacity < need) new_capacity *= 2;
+    void *new_ptr = realloc(*ptr, new_capacity * item);
+    if (!new_ptr) {
+      status = MEMORY_ERROR;
+    } else {
+      *ptr = new_ptr;
+      *capacity = new_capacity;
+    }
+  }
+  return status;
+}
+
+/**
+ * @brief Ищет слот шаблона в хеш-таблице
+ * @param store хранилище
+ * @param pattern шаблон
+ * @param len длина шаблона
+ * @return индекс слота: занятого этим шаблоном или первого пустого
+ */
+static size_t find_slot(const PatternStore *store, const char *pattern,
+                        size_t len) {
+  size_t mask = store->num_slots - 1;
+  size_t slot = fnv1a_hash(FNV_OFFSET_BASIS, pattern, len) & mask;
+  int found = 0;
+  while (store->slots[slot] && !found) {
+    size_t index = store->slots[slot] - 1;
+    found = (store->lengths[index] == len &&
+             memcmp(store->data + store->offsets[index], pattern, len) == 0);
+    if (!found) slot = (slot + 1) & mask;
+  }
+  return slot;
+}
+
+/**
+ * @brief Увеличивает хеш-таблицу вдвое и перераспределяет индексы
+ * @param store хранилище
+ * @return Код ошибки
+ */
+static ErrorCode rehash(PatternStore *store) {
+  ErrorCode status = SUCCESS;
+  size_t num_slots = store->num_slots ? store->num_slots * 2
+                                      : PATTERN_STORE_INIT_COUNT * 2;
+  size_t *slots = calloc(num_slots, sizeof(size_t));
+  if (!slots) {
+    status = MEMORY_ERROR;
+  } else {
+    free(store->slots);
+    store->slots = slots;
+    store->num_slots = num_slots;
+    for (size_t i = 0; i < store->count; i++) {
+      const char *pattern = store->data + store->offsets[i];
+      store->slots[find_slot(store, pattern, store->lengths[i])] = i + 1;
+    }
+  }
+  return status;
+}
+
+ErrorCode pattern_store_add(PatternStore *store, const char *pattern,
+                            size_t len) {
+  ErrorCode status = SUCCESS;
+  if ((store->count + 1) * 2 > store->num_slots) status = rehash(store);
+
+  size_t slot = status == SUCCESS ? find_slot(store, pattern, len) : 0;
+  if (status == SUCCESS && !store->slots[slot]) {
+    status = grow((void **)&store->data, &store->data_capacity,
+                  store->data_size + len + 1, 1, PATTERN_STORE_INIT_DATA);
+    size_t capacity = store->capacity;
+    if (status == SUCCESS) {
+      status = grow((void **)&store->offsets, &capacity, store->count + 1,
+                    sizeof(size_t), PATTERN_STORE_INIT_COUNT);
+    }
+    if (status == SUCCESS) {
+      status = grow((void **)&store->lengths, &store->capacity,
+                    store->count + 1, sizeof(size_t), PATTERN_STORE_INIT_COUNT);
+    }
+    if (status == SUCCESS) {
+      memcpy(store->data + store->data_size, pattern, len);
+      store->data[store->data_size + len] = '\0';
+      store->offsets[store->count] = store->data_size;
+      store->lengths[store->count] = len;
+      store->data_size += len + 1;
+      store->slots[slot] = ++store->count;
+    }
+  }
+  return status;
+}
+
+size_t pattern_store_find(const PatternStore *store, const char *pattern,
+                          size_t len) {
+  size_t index = store->count;
+  if (store->num_slots) {
+    size_t slot = find_slot(store, pattern, len);
+    if (store->slots[slot]) index = store->slots[slot] - 1;
+  }
+  return index;
+}
+
+const char *pattern_store_get(const PatternStore *store, size_t index) {
+  return store->data + store->offsets[index];
+}
+
+uint64_t fnv1a_hash(uint64_t hash, const void *data, size_t size) {
+  const unsigned char *bytes = data;
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ bytes[i]) * FNV_PRIME;
+  }
+  return hash;
+}
+
+void pattern_store_free(PatternStore *store) {
+  free(store->data);
+  free(store->offsets);
+  free(store->lengths);
+  free(store->slots);
+  memset(store, 0, sizeof(*store));
+  return;
+}
@@ -0,0 +1,73 @@
+#ifndef PATTERN_STORE_H
+#define PATTERN_STORE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "error_codes.h"
+
+#define PATTERN_STORE_INIT_DATA 4096  ///< Начальный размер арены
+#define PATTERN_STORE_INIT_COUNT 64   ///< Начальная емкость индекса
+#define FNV_OFFSET_BASIS 14695981039346656037ULL  ///< FNV-1a: начальное
+#define FNV_PRIME 1099511628211ULL                ///< FNV-1a: множитель
+
+/**
+ * @brief Хранилище шаблонов в единой арене без дубликатов
+ */
+typedef struct {
+  char *data;       ///< Арена: шаблоны, завершенные '\0'
+  size_t data_size;  ///< Занятый размер арены
+  size_t data_capacity;  ///< Емкость арены
+  size_t *offsets;  ///< Смещения шаблонов в арене
+  size_t *lengths;  ///< Длины шаблонов
+  size_t count;     ///< Количество шаблонов
+  size_t capacity;  ///< Емкость массивов смещений и длин
+  size_t *slots;  ///< Хеш-таблица: индекс шаблона + 1 (0 - пусто)
+  size_t num_slots;  ///< Размер хеш-таблицы (степень двойки)
+} PatternStore;
+
+/**
+ * @brief Добавляет шаблон, если такого еще нет
+ * @param store хранилище
+ * @param pattern шаблон
+ * @param len длина шаблона
+ * @return Код ошибки
+ */
+ErrorCode pattern_store_add(PatternStore *store, const char *pattern,
+                            size_t len);
+
+/**
+ * @brief Ищет шаблон в хранилище
+ * @param store хранилище
+ * @param pattern шаблон
+ * @param len длина шаблона
+ * @return индекс шаблона или store->count, если шаблона нет
+ */
+size_t pattern_store_find(const PatternStore *store, const char *pattern,
+                          size_t len);
+
+/**
+ * @brief Возвращает шаблон по индексу
+ * @param store хранилище
+ * @param index индекс шаблона
+ * @return указатель на строку, действителен до следующего добавления
+ */
+const char *pattern_store_get(const PatternStore *store, size_t index);
+
+/**
+ * @brief Хеш FNV-1a произвольного блока данных
+ * @param hash начальное значение (FNV_OFFSET_BASIS)
+ * @param data данные
+ * @param size размер данных
+ * @return новое значение хеша
+ */
+uint64_t fnv1a_hash(uint64_t hash, const void *data, size_t size);
+
+/**
+ * @brief Освобождает хранилище
+ * @param store хранилище
+ */
+void pattern_store_free(PatternStore *store);
+
+#endif  // PATTERN_STORE_H
@@ -0,0 +1,192 @@
+#define _GNU_SOURCE
+#include "pipe_reader.h"
+
+#include <poll.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#else
+#include <sched.h>
+#endif
+
+/**
+ * @brief Ждет, пока значение счетчика отличается от expected
+ * @param counter счетчик
+ * @param expected ожидаемое значение
+ */
+static void counter_wait(_Atomic uint32_t *counter, uint32_t expected) {
+#ifdef __linux__
+  syscall(SYS_futex, (uint32_t *)counter, FUTEX_WAIT_PRIVATE, expected, NULL,
+          NULL, 0);
+#else
+  (void)counter;
+  (void)expected;
+  sched_yield();
+#endif
+  return;
+}
+
+/**
+ * @brief Будит сторону, ожидающую изменения счетчика
+ * @param counter счетчик
+ */
+static void counter_wake(_Atomic uint32_t *counter) {
+#ifdef __linux__
+  syscall(SYS_futex, (uint32_t *)counter, FUTEX_WAKE_PRIVATE, 1, NULL, NULL,
+          0);
+#else
+  (void)counter;
+#endif
+  return;
+}
+
+/**
+ * @brief Читает очередную порцию ввода, прерываясь по запросу остановки
+ *
+ * read() блокируется до появления данных, поэтому перед ним поток ждет в
+ * poll() готовности ввода или байта в канале пробуждения от
+ * pipe_reader_close.
+ * @param reader конвейер
+ * @param data буфер на PIPE_BUFFER_SIZE байт
+ * @return количество байт, 0 в конце ввода или при остановке, -1 при ошибке
+ */
+static ssize_t pipe_read(PipeReader *reader, char *data) {
+  struct pollfd fds[2] = {{reader->fd, POLLIN, 0},
+                          {reader->wake_fds[0], POLLIN, 0}};
+  ssize_t got = 0;
+  int ready;
+  do {
+    ready = poll(fds, 2, -1);
+  } while (ready < 0 && errno == EINTR);
+  if (ready < 0 || !(fds[1].revents & POLLIN)) {
+    do {
+      got = read(reader->fd, data, PIPE_BUFFER_SIZE);
+    } while (got < 0 && errno == EINTR);
+  }
+  return got;
+}
+
+/**
+ * @brief Цикл потока чтения: заполняет свободные буферы до конца ввода
+ * @param arg конвейер
+ * @return NULL
+ */
+static void *pipe_producer(void *arg) {
+  PipeReader *reader = arg;
+  int done = 0;
+  while (!done) {
+    uint32_t head = atomic_load_explicit(&reader->head, memory_order_relaxed);
+    uint32_t wakeups =
+        atomic_load_explicit(&reader->wakeups, memory_order_acquire);
+    uint32_t tail = atomic_load_explicit(&reader->tail, memory_order_acquire);
+    while (head - tail == PIPE_BUFFERS && !atomic_load(&reader->stop)) {
+      counter_wait(&reader->wakeups, wakeups);
+      wakeups = atomic_load_explicit(&reader->wakeups, memory_order_acquire);
+      tail = atomic_load_explicit(&reader->tail, memory_order_acquire);
+    }
+    done = atomic_load(&reader->stop);
+    if (!done) {
+      PipeBuffer *buffer = &reader->buffers[head % PIPE_BUFFERS];
+      ssize_t got = pipe_read(reader, buffer->data);
+      buffer->size = got > 0 ? (size_t)got : 0;
+      buffer->error = got < 0 ? errno : 0;
+      done = (got <= 0);
+      atomic_store_explicit(&reader->head, head + 1, memory_order_release);
+      counter_wake(&reader->head);
+    }
+  }
+  return NULL;
+}
+
+/**
+ * @brief Функция чтения потока FILE (fopencookie)
+ * @param cookie конвейер
+ * @param buf буфер
+ * @param size размер буфера
+ * @return количество байт, 0 в конце ввода или -1 при ошибке
+ */
+static ssize_t pipe_cookie_read(void *cookie, char *buf, size_t size) {
+  PipeReader *reader = cookie;
+  uint32_t tail = atomic_load_explicit(&reader->tail, memory_order_relaxed);
+  uint32_t head = atomic_load_explicit(&reader->head, memory_order_acquire);
+  while (head == tail) {
+    counter_wait(&reader->head, head);
+    head = atomic_load_explicit(&reader->head, memory_order_acquire);
+  }
+
+  PipeBuffer *buffer = &reader->buffers[tail % PIPE_BUFFERS];
+  ssize_t copied = 0;
+  if (buffer->size == 0) {
+    errno = buffer->error;
+    copied = buffer->error ? -1 : 0;
+  } else {
+    size_t left = buffer->size - reader->offset;
+    copied = (ssize_t)(size < left ? size : left);
+    memcpy(buf, buffer->data + reader->offset, copied);
+    reader->offset += copied;
+    if (reader->offset == buffer->size) {
+      reader->offset = 0;
+      atomic_store_explicit(&reader->tail, tail + 1, memory_order_release);
+      atomic_fetch_add(&reader->wakeups, 1);
+      counter_wake(&reader->wakeups);
+    }
+  }
+  return copied;
+}
+
+/**
+ * @brief Освобождает буферы и канал пробуждения
+ * @param reader конвейер
+ */
+static void pipe_reader_free(PipeReader *reader) {
+  for (int i = 0; i < PIPE_BUFFERS; i++) free(reader->buffers[i].data);
+  if (reader->wake_fds[0] >= 0) close(reader->wake_fds[0]);
+  if (reader->wake_fds[1] >= 0) close(reader->wake_fds[1]);
+  return;
+}
+
+int pipe_reader_enabled(int fd) {
+  const char *env = getenv(PIPE_READER_ENV);
+  return env && strcmp(env, "1") == 0 && !isatty(fd);
+}
+
+FILE *pipe_reader_open(PipeReader *reader, int fd) {
+  cookie_io_functions_t io = {pipe_cookie_read, NULL, NULL, NULL};
+  int ok = 1;
+  memset(reader, 0, sizeof(*reader));
+  reader->fd = fd;
+  reader->wake_fds[0] = reader->wake_fds[1] = -1;
+  ok = (pipe(reader->wake_fds) == 0);
+  for (int i = 0; i < PIPE_BUFFERS && ok; i++) {
+    reader->buffers[i].data = malloc(PIPE_BUFFER_SIZE);
+    ok = (reader->buffers[i].data != NULL);
+  }
+  if (ok) reader->stream = fopencookie(reader, "rb", io);
+  if (reader->stream) {
+    setvbuf(reader->stream, NULL, _IOFBF, PIPE_STDIO_BUFFER);
+    if (pthread_create(&reader->thread, NULL, pipe_producer, reader) != 0) {
+      fclose(reader->stream);
+      reader->stream = NULL;
+    }
+  }
+  if (!reader->stream) pipe_reader_free(reader);
+  return reader->stream;
+}
+
+void pipe_reader_close(PipeReader *reader) {
+  if (reader->stream) {
+    ssize_t rc;
+    fclose(reader->stream);
+    atomic_store(&reader->stop, 1);
+    atomic_fetch_add(&reader->wakeups, 1);
+    counter_wake(&reader->wakeups);
+    do {
+      rc = write(reader->wake_fds[1], "", 1);
+    } while (rc < 0 && errno == EINTR);
+    pthread_join(reader->thread, NULL);
+    pipe_reader_free(reader);
+    reader->stream = NULL;
+  }
+  return;
+}
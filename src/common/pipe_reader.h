@@ -0,0 +1,71 @@
+#ifndef PIPE_READER_H
+#define PIPE_READER_H
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define PIPE_READER_ENV "S21_PIPELINE"  ///< "1" - включить конвейер для stdin
+#define PIPE_BUFFERS 8                  ///< Количество буферов (степень 2)
+#define PIPE_BUFFER_SIZE (256 * 1024)   ///< Размер одного буфера
+#define PIPE_STDIO_BUFFER (64 * 1024)   ///< Размер буфера потока FILE
+
+/**
+ * @brief Буфер, заполненный потоком чтения
+ */
+typedef struct {
+  char *data;   ///< Данные
+  size_t size;  ///< Размер данных (0 - конец ввода)
+  int error;    ///< errno ошибки read
+} PipeBuffer;
+
+/**
+ * @brief Конвейер чтения: отдельный поток заполняет буферы через read()
+ *
+ * Буферы передаются между потоком чтения и основным потоком через кольцо
+ * с одним производителем и одним потребителем: счетчики head и tail
+ * изменяет только одна сторона, ожидание пустого или полного кольца
+ * выполняется через futex. Производитель ждет на счетчике wakeups, который
+ * увеличивают и освобождение буфера, и запрос остановки, поэтому
+ * пробуждение при закрытии не теряется.
+ */
+typedef struct {
+  PipeBuffer buffers[PIPE_BUFFERS];  ///< Кольцо буферов
+  _Atomic uint32_t head;             ///< Заполнено буферов (производитель)
+  _Atomic uint32_t tail;             ///< Освобождено буферов (потребитель)
+  _Atomic uint32_t wakeups;          ///< Счетчик пробуждений производителя
+  _Atomic int stop;                  ///< Запрос остановки потока чтения
+  int wake_fds[2];                   ///< Канал прерывания ожидания ввода
+  size_t offset;                     ///< Позиция чтения в текущем буфере
+  int fd;                            ///< Дескриптор ввода
+  pthread_t thread;                  ///< Поток чтения
+  FILE *stream;                      ///< Поток FILE поверх конвейера
+} PipeReader;
+
+/**
+ * @brief Проверяет, включен ли конвейер для дескриптора
+ * @param fd дескриптор ввода
+ * @return 1 если задан S21_PIPELINE=1 и ввод не терминал
+ */
+int pipe_reader_enabled(int fd);
+
+/**
+ * @brief Запускает поток чтения и создает поток FILE поверх конвейера
+ * @param reader конвейер
+ * @param fd дескриптор ввода
+ * @return поток FILE или NULL при ошибке
+ */
+FILE *pipe_reader_open(PipeReader *reader, int fd);
+
+/**
+ * @brief Закрывает поток FILE и останавливает поток чтения
+ * @param reader конвейер
+ */
+void pipe_reader_close(PipeReader *reader);
+
+#endif  // PIPE_READER_H
@@ -0,0 +1,420 @@
+#define _GNU_SOURCE
+#include "server.h"
+
+#include <poll.h>
+
+#define SERVE_MAX_FDS 3  ///< Дескрипторов в первом сообщении запроса
+
+/**
+ * @brief Первое сообщение запроса
+ */
+typedef struct {
+  uint32_t magic;      ///< SERVE_MAGIC
+  uint32_t num_files;  ///< Количество файлов (0 - стандартный ввод)
+} ServeHello;
+
+/**
+ * @brief Очередь принятых соединений и общие данные пула
+ */
+typedef struct {
+  int socks[SERVE_QUEUE];        ///< Кольцевой буфер сокетов
+  size_t head;                   ///< Индекс первого элемента
+  size_t count;                  ///< Количество элементов
+  int shutdown;                  ///< Флаг завершения работы
+  pthread_mutex_t lock;          ///< Защита очереди
+  pthread_cond_t not_empty;      ///< Очередь не пуста
+  pthread_cond_t not_full;       ///< Очередь не заполнена
+  const void *opts;              ///< Общие настройки
+  const ServeHandler *handler;   ///< Обработчик запросов
+} ServeQueue;
+
+static volatile sig_atomic_t stop_requested = 0;
+
+/**
+ * @brief Обработчик SIGINT/SIGTERM
+ * @param sig номер сигнала
+ */
+static void request_stop(int sig) {
+  (void)sig;
+  stop_requested = 1;
+}
+
+/**
+ * @brief Отправляет сообщение с дескрипторами (SCM_RIGHTS)
+ * @param sock сокет
+ * @param buf данные
+ * @param size размер данных
+ * @param fds дескрипторы
+ * @param num_fds количество дескрипторов (не более SERVE_MAX_FDS)
+ * @return результат sendmsg
+ */
+static ssize_t send_with_fds(int sock, const void *buf, size_t size,
+                             const int *fds, int num_fds) {
+  union {
+    struct cmsghdr align;
+    char buf[CMSG_SPACE(SERVE_MAX_FDS * sizeof(int))];
+  } control;
+  struct iovec iov = {(void *)buf, size};
+  struct msghdr msg = {0};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  if (num_fds > 0) {
+    memset(&control, 0, sizeof(control));
+    msg.msg_control = control.buf;
+    msg.msg_controllen = CMSG_SPACE(num_fds * sizeof(int));
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(num_fds * sizeof(int));
+    memcpy(CMSG_DATA(cmsg), fds, num_fds * sizeof(int));
+  }
+  return sendmsg(sock, &msg, MSG_NOSIGNAL);
+}
+
+/**
+ * @brief Принимает сообщение с дескрипторами
+ * @param sock сокет
+ * @param buf буфер данных
+ * @param size размер буфера
+ * @param fds массив на SERVE_MAX_FDS дескрипторов
+ * @param num_fds количество полученных дескрипторов
+ * @return результат recvmsg
+ */
+static ssize_t recv_with_fds(int sock, void *buf, size_t size, int *fds,
+                             int *num_fds) {
+  union {
+    struct cmsghdr align;
+    char buf[CMSG_SPACE(SERVE_MAX_FDS * sizeof(int))];
+  } control;
+  struct iovec iov = {buf, size};
+  struct msghdr msg = {0};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof(control.buf);
+  *num_fds = 0;
+  ssize_t got = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+  for (struct cmsghdr *cmsg = got >= 0 ? CMSG_FIRSTHDR(&msg) : NULL; cmsg;
+       cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+      int count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+      for (int i = 0; i < count; i++) {
+        int fd;
+        memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+        if (*num_fds < SERVE_MAX_FDS) {
+          fds[(*num_fds)++] = fd;
+        } else {
+          close(fd);
+        }
+      }
+    }
+  }
+  return got;
+}
+
+/**
+ * @brief Передает обработчику один файл запроса
+ * @param handler обработчик запросов
+ * @param state состояние запроса
+ * @param filename имя файла
+ * @param fd дескриптор файла или -1
+ */
+static void serve_file(const ServeHandler *handler, void *state,
+                       const char *filename, int fd) {
+  FILE *fp = fd >= 0 ? fdopen(fd, "rb") : NULL;
+  if (!fp && fd >= 0) close(fd);
+  handler->file(state, filename, fp);
+  if (fp) fclose(fp);
+  return;
+}
+
+/**
+ * @brief Принимает имена и дескрипторы файлов запроса и обрабатывает их
+ * @param handler обработчик запросов
+ * @param state состояние запроса
+ * @param sock сокет клиента
+ * @param num_files количество файлов
+ * @return 1 если все файлы получены, иначе 0
+ */
+static int serve_files(const ServeHandler *handler, void *state, int sock,
+                       uint32_t num_files) {
+  char name[SERVE_MAX_NAME + 1];
+  int ok = 1;
+  for (uint32_t i = 0; i < num_files && ok; i++) {
+    int fds[SERVE_MAX_FDS];
+    int num_fds = 0;
+    ssize_t got = recv_with_fds(sock, name, SERVE_MAX_NAME, fds, &num_fds);
+    ok = (got > 0);
+    for (int j = 1; j < num_fds; j++) close(fds[j]);
+    if (ok) {
+      name[got] = '\0';
+      serve_file(handler, state, name, num_fds ? fds[0] : -1);
+    } else if (num_fds) {
+      close(fds[0]);
+    }
+  }
+  return ok;
+}
+
+/**
+ * @brief Обрабатывает одно соединение клиента
+ * @param queue очередь с общими данными
+ * @param worker данные рабочего потока
+ * @param sock сокет клиента
+ */
+static void handle_connection(const ServeQueue *queue, void *worker,
+                              int sock) {
+  ServeHello hello = {0};
+  int fds[SERVE_MAX_FDS];
+  int num_fds = 0;
+  int stdin_used = 0;
+  ssize_t got = recv_with_fds(sock, &hello, sizeof(hello), fds, &num_fds);
+  int valid = (got == (ssize_t)sizeof(hello) && hello.magic == SERVE_MAGIC &&
+               num_fds == (hello.num_files ? 2 : 3));
+  FILE *out = valid ? fdopen(fds[0], "w") : NULL;
+  FILE *err = out ? fdopen(fds[1], "w") : NULL;
+  if (err) setvbuf(err, NULL, _IONBF, 0);
+  void *state =
+      err ? queue->handler->begin(queue->opts, worker, out, err,
+                                  hello.num_files)
+          : NULL;
+
+  if (state) {
+    int ok = 1;
+    if (hello.num_files == 0) {
+      serve_file(queue->handler, state, SERVE_STDIN_NAME, fds[2]);
+      stdin_used = 1;
+    } else {
+      ok = serve_files(queue->handler, state, sock, hello.num_files);
+    }
+    unsigned char reply = (unsigned char)queue->handler->end(state);
+    fflush(out);
+    if (ok) send(sock, &reply, 1, MSG_NOSIGNAL);
+  }
+
+  if (out) {
+    fclose(out);
+  } else if (num_fds > 0) {
+    close(fds[0]);
+  }
+  if (err) {
+    fclose(err);
+  } else if (num_fds > 1) {
+    close(fds[1]);
+  }
+  if (num_fds > 2 && !stdin_used) close(fds[2]);
+  return;
+}
+
+/**
+ * @brief Извлекает сокет из очереди
+ * @param queue очередь
+ * @return сокет или -1 при завершении работы
+ */
+static int queue_pop(ServeQueue *queue) {
+  int sock = -1;
+  pthread_mutex_lock(&queue->lock);
+  while (queue->count == 0 && !queue->shutdown) {
+    pthread_cond_wait(&queue->not_empty, &queue->lock);
+  }
+  if (queue->count > 0) {
+    sock = queue->socks[queue->head];
+    queue->head = (queue->head + 1) % SERVE_QUEUE;
+    queue->count--;
+    pthread_cond_signal(&queue->not_full);
+  }
+  pthread_mutex_unlock(&queue->lock);
+  return sock;
+}
+
+/**
+ * @brief Добавляет сокет в очередь, ожидая свободного места
+ * @param queue очередь
+ * @param sock сокет клиента
+ */
+static void queue_push(ServeQueue *queue, int sock) {
+  pthread_mutex_lock(&queue->lock);
+  while (queue->count == SERVE_QUEUE) {
+    pthread_cond_wait(&queue->not_full, &queue->lock);
+  }
+  queue->socks[(queue->head + queue->count) % SERVE_QUEUE] = sock;
+  queue->count++;
+  pthread_cond_signal(&queue->not_empty);
+  pthread_mutex_unlock(&queue->lock);
+  return;
+}
+
+/**
+ * @brief Цикл рабочего потока
+ * @param arg очередь
+ * @return NULL
+ */
+static void *serve_worker(void *arg) {
+  ServeQueue *queue = arg;
+  const ServeHandler *handler = queue->handler;
+  void *worker =
+      handler->worker_begin ? handler->worker_begin(queue->opts) : NULL;
+  int sock;
+  while ((sock = queue_pop(queue)) >= 0) {
+    handle_connection(queue, worker, sock);
+    close(sock);
+  }
+  if (handler->worker_end) handler->worker_end(worker);
+  return NULL;
+}
+
+/**
+ * @brief Создает слушающий сокет, заменяя устаревший файл сокета
+ * @param socket_path путь к сокету
+ * @return дескриптор или -1
+ */
+static int open_listener(const char *socket_path) {
+  struct sockaddr_un addr = {0};
+  struct stat st;
+  int fd = -1;
+  addr.sun_family = AF_UNIX;
+  if (strlen(socket_path) < sizeof(addr.sun_path)) {
+    strcpy(addr.sun_path, socket_path);
+    if (lstat(socket_path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+      unlink(socket_path);
+    }
+    fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+  } else {
+    errno = ENAMETOOLONG;
+  }
+  if (fd >= 0 && (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+                  listen(fd, SOMAXCONN) != 0)) {
+    close(fd);
+    fd = -1;
+  }
+  return fd;
+}
+
+/**
+ * @brief Принимает соединения до сигнала завершения
+ * @param queue очередь
+ * @param listener слушающий сокет
+ * @param wait_mask маска сигналов на время ожидания
+ */
+static void accept_loop(ServeQueue *queue, int listener,
+                        const sigset_t *wait_mask) {
+  struct pollfd pfd = {listener, POLLIN, 0};
+  while (!stop_requested) {
+    if (ppoll(&pfd, 1, NULL, wait_mask) > 0) {
+      int sock = accept4(listener, NULL, NULL, SOCK_CLOEXEC);
+      if (sock >= 0) queue_push(queue, sock);
+    }
+  }
+  return;
+}
+
+/**
+ * @brief Устанавливает обработчики сигналов сервера
+ * @param blocked маска SIGINT/SIGTERM
+ * @param wait_mask исходная маска сигналов
+ */
+static void install_signals(sigset_t *blocked, sigset_t *wait_mask) {
+  struct sigaction sa = {0};
+  sa.sa_handler = request_stop;
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+  signal(SIGPIPE, SIG_IGN);
+  sigemptyset(blocked);
+  sigaddset(blocked, SIGINT);
+  sigaddset(blocked, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, blocked, wait_mask);
+  return;
+}
+
+ErrorCode serve_requests(const char *socket_path, const void *opts,
+                         const ServeHandler *handler,
+                         const char *program_name) {
+  ErrorCode status = SUCCESS;
+  int listener = open_listener(socket_path);
+  if (listener < 0) {
+    print_error(program_name, socket_path, strerror(errno));
+    status = FILE_ERROR;
+  } else {
+    ServeQueue queue = {.opts = opts, .handler = handler};
+    pthread_t workers[SERVE_WORKERS];
+    sigset_t blocked;
+    sigset_t wait_mask;
+    pthread_mutex_init(&queue.lock, NULL);
+    pthread_cond_init(&queue.not_empty, NULL);
+    pthread_cond_init(&queue.not_full, NULL);
+    install_signals(&blocked, &wait_mask);
+    int started = 0;
+    while (started < SERVE_WORKERS &&
+           pthread_create(&workers[started], NULL, serve_worker, &queue) == 0) {
+      started++;
+    }
+
+    accept_loop(&queue, listener, &wait_mask);
+    pthread_mutex_lock(&queue.lock);
+    queue.shutdown = 1;
+    pthread_cond_broadcast(&queue.not_empty);
+    pthread_mutex_unlock(&queue.lock);
+    for (int i = 0; i < started; i++) pthread_join(workers[i], NULL);
+    close(listener);
+    unlink(socket_path);
+    pthread_sigmask(SIG_SETMASK, &wait_mask, NULL);
+  }
+  return status;
+}
+
+/**
+ * @brief Передает серверу имя и дескриптор одного файла
+ * @param sock сокет
+ * @param filename имя файла ("-" - стандартный ввод)
+ * @return Код ошибки
+ */
+static ErrorCode send_file(int sock, const char *filename) {
+  int is_stdin = (strcmp(filename, "-") == 0);
+  const char *name = is_stdin ? SERVE_STDIN_NAME : filename;
+  int fd = is_stdin ? STDIN_FILENO : open(filename, O_RDONLY | O_CLOEXEC);
+  size_t len = strlen(name);
+  if (len > SERVE_MAX_NAME) len = SERVE_MAX_NAME;
+
+  ErrorCode status = SUCCESS;
+  if (send_with_fds(sock, name, len, &fd, fd >= 0 ? 1 : 0) < 0) {
+    status = FILE_ERROR;
+  }
+  if (fd >= 0 && !is_stdin) close(fd);
+  return status;
+}
+
+ErrorCode serve_client(const char *socket_path, int num_files, char **files,
+                       const char *program_name, int *exit_status) {
+  ErrorCode status = SUCCESS;
+  struct sockaddr_un addr = {0};
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+  int sock = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+  if (sock < 0 ||
+      connect(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+    print_error(program_name, socket_path, strerror(errno));
+    status = FILE_ERROR;
+  } else {
+    ServeHello hello = {SERVE_MAGIC, (uint32_t)num_files};
+    int fds[SERVE_MAX_FDS] = {STDOUT_FILENO, STDERR_FILENO, STDIN_FILENO};
+    unsigned char reply = 0;
+    fflush(stdout);
+    if (send_with_fds(sock, &hello, sizeof(hello), fds,
+                      num_files ? 2 : 3) < 0) {
+      status = FILE_ERROR;
+    }
+    for (int i = 0; i < num_files && status == SUCCESS; i++) {
+      status = send_file(sock, files[i]);
+    }
+    if (status == SUCCESS && recv(sock, &reply, 1, 0) != 1) {
+      status = FILE_ERROR;
+    }
+    if (status != SUCCESS) {
+      print_error(program_name, socket_path, "connection lost");
+    }
+    *exit_status = reply;
+  }
+  if (sock >= 0) close(sock);
+  return status;
+}
@@ -0,0 +1,81 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "error.h"
+#include "error_codes.h"
+
+#define SERVE_MAGIC 0x47313253U  ///< Сигнатура запроса ("S21G")
+#define SERVE_WORKERS 4          ///< Количество рабочих потоков
+#define SERVE_QUEUE 64           ///< Емкость очереди соединений
+#define SERVE_MAX_NAME 4096      ///< Максимальная длина имени файла
+#define SERVE_STDIN_NAME "(standard input)"  ///< Имя стандартного ввода
+
+/**
+ * @brief Обработчик запросов сервера (Callback)
+ *
+ * worker_begin вызывается при запуске рабочего потока и возвращает данные
+ * потока (NULL - общие настройки), worker_end - при его остановке; так
+ * каждый поток может держать свои копии ресурсов, которые нельзя
+ * использовать параллельно. begin вызывается в начале запроса с данными
+ * потока и возвращает состояние запроса, file - для каждого файла
+ * (fp == NULL, если клиент не смог открыть файл), end - в конце запроса
+ * и возвращает код завершения для клиента.
+ */
+typedef struct {
+  void *(*worker_begin)(const void *opts);
+  void (*worker_end)(void *worker);
+  void *(*begin)(const void *opts, void *worker, FILE *out, FILE *err,
+                 size_t num_files);
+  void (*file)(void *state, const char *filename, FILE *fp);
+  int (*end)(void *state);
+} ServeHandler;
+
+/**
+ * @brief Запускает сервер на Unix-сокете
+ *
+ * Соединения принимаются в основном потоке и обрабатываются пулом из
+ * SERVE_WORKERS потоков. Вывод пишется напрямую в дескрипторы stdout и
+ * stderr, переданные клиентом. Работа завершается по SIGINT/SIGTERM.
+ *
+ * Соединение занимает поток до конца запроса; запрос со стандартным вводом
+ * длится до EOF на стороне клиента без тайм-аута, поэтому SERVE_WORKERS
+ * долгих потоков задерживают остальные соединения в очереди.
+ * @param socket_path путь к сокету
+ * @param opts общие настройки (только для чтения)
+ * @param handler обработчик запросов
+ * @param program_name имя программы
+ * @return Код ошибки
+ */
+ErrorCode serve_requests(const char *socket_path, const void *opts,
+                         const ServeHandler *handler,
+                         const char *program_name);
+
+/**
+ * @brief Отправляет запрос серверу и ждет его завершения
+ *
+ * Файлы открываются на стороне клиента и передаются как дескрипторы;
+ * при отсутствии файлов передается стандартный ввод.
+ * @param socket_path путь к сокету
+ * @param num_files количество файлов
+ * @param files имена файлов ("-" - стандартный ввод)
+ * @param program_name имя программы
+ * @param exit_status код завершения, полученный от сервера
+ * @return Код ошибки
+ */
+ErrorCode serve_client(const char *socket_path, int num_files, char **files,
+                       const char *program_name, int *exit_status);
+
+#endif  // SERVER_H
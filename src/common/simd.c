@@ -0,0 +1,366 @@
+#include "simd.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define SIMD_X86 1  ///< Доступны версии для x86-64
+#endif
+
+/**
+ * @brief Таблица версий ядер для выбранного уровня
+ */
+typedef struct {
+  size_t (*count_byte)(const char *, size_t, unsigned char);
+  const char *(*find_byte2)(const char *, size_t, unsigned char,
+                            unsigned char);
+  const char *(*find_special)(const char *, size_t);
+} SimdKernels;
+
+/**
+ * @brief Считает вхождения байта (по 8 байт в слове)
+ * @param text буфер
+ * @param len длина буфера
+ * @param c байт
+ * @return количество вхождений
+ */
+static size_t count_byte_scalar(const char *text, size_t len,
+                                unsigned char c) {
+  const uint64_t ones = 0x0101010101010101ULL;
+  const uint64_t low7 = 0x7f7f7f7f7f7f7f7fULL;
+  size_t count = 0;
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, text + i, sizeof(word));
+    word ^= ones * c;
+    uint64_t nonzero = ((word & low7) + low7) | word;
+    count += __builtin_popcountll(~nonzero & ~low7);
+  }
+  for (; i < len; i++) count += ((unsigned char)text[i] == c);
+  return count;
+}
+
+/**
+ * @brief Ищет первый байт, равный a или b (побайтно)
+ * @param text буфер
+ * @param len длина буфера
+ * @param a первый байт
+ * @param b второй байт
+ * @return указатель на найденный байт или NULL
+ */
+static const char *find_byte2_scalar(const char *text, size_t len,
+                                     unsigned char a, unsigned char b) {
+  const char *found = NULL;
+  for (size_t i = 0; i < len && !found; i++) {
+    unsigned char c = text[i];
+    if (c == a || c == b) found = text + i;
+  }
+  return found;
+}
+
+/**
+ * @brief Ищет первый байт вне 32..126 (побайтно)
+ * @param text буфер
+ * @param len длина буфера
+ * @return указатель на найденный байт или NULL
+ */
+static const char *find_special_scalar(const char *text, size_t len) {
+  const char *found = NULL;
+  for (size_t i = 0; i < len && !found; i++) {
+    unsigned char c = text[i];
+    if (c < 32 || c > 126) found = text + i;
+  }
+  return found;
+}
+
+#ifdef SIMD_X86
+/**
+ * @brief Сумма 16 байтовых счетчиков
+ * @param acc счетчики
+ * @return сумма
+ */
+static size_t sum_bytes_sse2(__m128i acc) {
+  __m128i sums = _mm_sad_epu8(acc, _mm_setzero_si128());
+  return _mm_cvtsi128_si32(sums) + _mm_extract_epi16(sums, 4);
+}
+
+/**
+ * @brief Считает вхождения байта (SSE2)
+ * @param text буфер
+ * @param len длина буфера
+ * @param c байт
+ * @return количество вхождений
+ */
+static size_t count_byte_sse2(const char *text, size_t len,
+                              unsigned char c) {
+  const __m128i needle = _mm_set1_epi8((char)c);
+  __m128i acc = _mm_setzero_si128();
+  size_t count = 0;
+  size_t i = 0;
+  for (int round = 0; i + 16 <= len; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(text + i));
+    acc = _mm_sub_epi8(acc, _mm_cmpeq_epi8(v, needle));
+    if (++round == 255) {
+      count += sum_bytes_sse2(acc);
+      acc = _mm_setzero_si128();
+      round = 0;
+    }
+  }
+  return count + sum_bytes_sse2(acc) +
+         count_byte_scalar(text + i, len - i, c);
+}
+
+/**
+ * @brief Ищет первый байт, равный a или b (SSE2)
+ * @param text буфер
+ * @param len длина буфера
+ * @param a первый байт
+ * @param b второй байт
+ * @return указатель на найденный байт или NULL
+ */
+static const char *find_byte2_sse2(const char *text, size_t len,
+                                   unsigned char a, unsigned char b) {
+  const __m128i va = _mm_set1_epi8((char)a);
+  const __m128i vb = _mm_set1_epi8((char)b);
+  const char *found = NULL;
+  size_t i = 0;
+  for (; i + 16 <= len && !found; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(text + i));
+    unsigned mask = _mm_movemask_epi8(
+        _mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)));
+    if (mask) found = text + i + __builtin_ctz(mask);
+  }
+  return found ? found : find_byte2_scalar(text + i, len - i, a, b);
+}
+
+/**
+ * @brief Ищет первый байт вне 32..126 (SSE2)
+ * @param text буфер
+ * @param len длина буфера
+ * @return указатель на найденный байт или NULL
+ */
+static const char *find_special_sse2(const char *text, size_t len) {
+  const __m128i low = _mm_set1_epi8(31);
+  const __m128i high = _mm_set1_epi8(127);
+  const char *found = NULL;
+  size_t i = 0;
+  for (; i + 16 <= len && !found; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(text + i));
+    __m128i plain =
+        _mm_and_si128(_mm_cmpgt_epi8(v, low), _mm_cmplt_epi8(v, high));
+    unsigned mask = ~(unsigned)_mm_movemask_epi8(plain) & 0xFFFFU;
+    if (mask) found = text + i + __builtin_ctz(mask);
+  }
+  return found ? found : find_special_scalar(text + i, len - i);
+}
+
+/**
+ * @brief Сумма 32 байтовых счетчиков
+ * @param acc счетчики
+ * @return сумма
+ */
+__attribute__((target("avx2"))) static size_t sum_bytes_avx2(__m256i acc) {
+  __m256i sums = _mm256_sad_epu8(acc, _mm256_setzero_si256());
+  return _mm256_extract_epi64(sums, 0) + _mm256_extract_epi64(sums, 1) +
+         _mm256_extract_epi64(sums, 2) + _mm256_extract_epi64(sums, 3);
+}
+
+/**
+ * @brief Считает вхождения байта (AVX2)
+ * @param text буфер
+ * @param len длина буфера
+ * @param c байт
+ * @return количество вхождений
+ */
+__attribute__((target("avx2"))) static size_t count_byte_avx2(
+    const char *text, size_t len, unsigned char c) {
+  const __m256i needle = _mm256_set1_epi8((char)c);
+  __m256i acc = _mm256_setzero_si256();
+  size_t count = 0;
+  size_t i = 0;
+  for (int round = 0; i + 32 <= len; i += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(text + i));
+    acc = _mm256_sub_epi8(acc, _mm256_cmpeq_epi8(v, needle));
+    if (++round == 255) {
+      count += sum_bytes_avx2(acc);
+      acc = _mm256_setzero_si256();
+      round = 0;
+    }
+  }
+  return count + sum_bytes_avx2(acc) +
+         count_byte_sse2(text + i, len - i, c);
+}
+
+/**
+ * @brief Ищет первый байт, равный a или b (AVX2)
+ * @param text буфер
+ * @param len длина буфера
+ * @param a первый байт
+ * @param b второй байт
+ * @return указатель на найденный байт или NULL
+ */
+__attribute__((target("avx2"))) static const char *find_byte2_avx2(
+    const char *text, size_t len, unsigned char a, unsigned char b) {
+  const __m256i va = _mm256_set1_epi8((char)a);
+  const __m256i vb = _mm256_set1_epi8((char)b);
+  const char *found = NULL;
+  size_t i = 0;
+  for (; i + 32 <= len && !found; i += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(text + i));
+    unsigned mask = _mm256_movemask_epi8(
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, va), _mm256_cmpeq_epi8(v, vb)));
+    if (mask) found = text + i + __builtin_ctz(mask);
+  }
+  return found ? found : find_byte2_sse2(text + i, len - i, a, b);
+}
+
+/**
+ * @brief Ищет первый байт вне 32..126 (AVX2)
+ * @param text буфер
+ * @param len длина буфера
+ * @return указатель на найденный байт или NULL
+ */
+__attribute__((target("avx2"))) static const char *find_special_avx2(
+    const char *text, size_t len) {
+  const __m256i low = _mm256_set1_epi8(31);
+  const __m256i high = _mm256_set1_epi8(127);
+  const char *found = NULL;
+  size_t i = 0;
+  for (; i + 32 <= len && !found; i += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(text + i));
+    __m256i plain = _mm256_and_si256(_mm256_cmpgt_epi8(v, low),
+                                     _mm256_cmpgt_epi8(high, v));
+    unsigned mask = ~(unsigned)_mm256_movemask_epi8(plain);
+    if (mask) found = text + i + __builtin_ctz(mask);
+  }
+  return found ? found : find_special_sse2(text + i, len - i);
+}
+
+/**
+ * @brief Считает вхождения байта (AVX-512BW)
+ * @param text буфер
+ * @param len длина буфера
+ * @param c байт
+ * @return количество вхождений
+ */
+__attribute__((target("avx512bw,popcnt"))) static size_t count_byte_avx512(
+    const char *text, size_t len, unsigned char c) {
+  const __m512i needle = _mm512_set1_epi8((char)c);
+  size_t count = 0;
+  size_t i = 0;
+  for (; i + 64 <= len; i += 64) {
+    __m512i v = _mm512_loadu_si512((const void *)(text + i));
+    count += _mm_popcnt_u64(_mm512_cmpeq_epi8_mask(v, needle));
+  }
+  return count + count_byte_avx2(text + i, len - i, c);
+}
+
+/**
+ * @brief Ищет первый байт, равный a или b (AVX-512BW)
+ * @param text буфер
+ * @param len длина буфера
+ * @param a первый байт
+ * @param b второй байт
+ * @return указатель на найденный байт или NULL
+ */
+__attribute__((target("avx512bw"))) static const char *find_byte2_avx512(
+    const char *text, size_t len, unsigned char a, unsigned char b) {
+  const __m512i va = _mm512_set1_epi8((char)a);
+  const __m512i vb = _mm512_set1_epi8((char)b);
+  const char *found = NULL;
+  size_t i = 0;
+  for (; i + 64 <= len && !found; i += 64) {
+    __m512i v = _mm512_loadu_si512((const void *)(text + i));
+    uint64_t mask =
+        _mm512_cmpeq_epi8_mask(v, va) | _mm512_cmpeq_epi8_mask(v, vb);
+    if (mask) found = text + i + __builtin_ctzll(mask);
+  }
+  return found ? found : find_byte2_avx2(text + i, len - i, a, b);
+}
+
+/**
+ * @brief Ищет первый байт вне 32..126 (AVX-512BW)
+ * @param text буфер
+ * @param len длина буфера
+ * @return указатель на найденный байт или NULL
+ */
+__attribute__((target("avx512bw"))) static const char *find_special_avx512(
+    const char *text, size_t len) {
+  const __m512i low = _mm512_set1_epi8(31);
+  const __m512i high = _mm512_set1_epi8(127);
+  const char *found = NULL;
+  size_t i = 0;
+  for (; i + 64 <= len && !found; i += 64) {
+    __m512i v = _mm512_loadu_si512((const void *)(text + i));
+    uint64_t mask = ~(uint64_t)(_mm512_cmpgt_epi8_mask(v, low) &
+                                _mm512_cmplt_epi8_mask(v, high));
+    if (mask) found = text + i + __builtin_ctzll(mask);
+  }
+  return found ? found : find_special_avx2(text + i, len - i);
+}
+#endif
+
+/**
+ * @brief Версии ядер по уровням
+ */
+static const SimdKernels simd_table[] = {
+    {count_byte_scalar, find_byte2_scalar, find_special_scalar},
+#ifdef SIMD_X86
+    {count_byte_sse2, find_byte2_sse2, find_special_sse2},
+    {count_byte_avx2, find_byte2_avx2, find_special_avx2},
+    {count_byte_avx512, find_byte2_avx512, find_special_avx512},
+#endif
+};
+
+static const char *const simd_names[] = {"scalar", "sse2", "avx2", "avx512"};
+
+static SimdLevel current_level = SIMD_SCALAR;  ///< Выбранный уровень
+static SimdKernels current = {count_byte_scalar, find_byte2_scalar,
+                              find_special_scalar};  ///< Выбранные версии
+
+/**
+ * @brief Определяет уровень процессора
+ * @return наибольший поддерживаемый уровень
+ */
+static SimdLevel detect_level(void) {
+  SimdLevel level = SIMD_SCALAR;
+#ifdef SIMD_X86
+  __builtin_cpu_init();
+  level = SIMD_SSE2;
+  if (__builtin_cpu_supports("avx2")) level = SIMD_AVX2;
+  if (level == SIMD_AVX2 && __builtin_cpu_supports("avx512bw")) {
+    level = SIMD_AVX512;
+  }
+#endif
+  return level;
+}
+
+/**
+ * @brief Выбирает версии ядер при запуске программы
+ */
+__attribute__((constructor)) static void simd_init(void) {
+  SimdLevel level = detect_level();
+  const char *env = getenv(SIMD_ENV);
+  for (int i = SIMD_SCALAR; env && i < (int)level; i++) {
+    if (strcmp(env, simd_names[i]) == 0) level = (SimdLevel)i;
+  }
+  current_level = level;
+  current = simd_table[level];
+  return;
+}
+
+size_t simd_count_byte(const char *text, size_t len, unsigned char c) {
+  return current.count_byte(text, len, c);
+}
+
+const char *simd_find_byte2(const char *text, size_t len, unsigned char a,
+                            unsigned char b) {
+  return current.find_byte2(text, len, a, b);
+}
+
+const char *simd_find_special(const char *text, size_t len) {
+  return current.find_special(text, len);
+}
+
+SimdLevel simd_level(void) { return current_level; }
+
+const char *simd_level_name(SimdLevel level) { return simd_names[level]; }
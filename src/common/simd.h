@@ -0,0 +1,68 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SIMD_ENV "S21_SIMD"  ///< Ограничение набора инструкций (для отладки)
+
+/**
+ * @brief Уровень набора инструкций
+ */
+typedef enum {
+  SIMD_SCALAR,  ///< Переносимая версия (по 8 байт в слове)
+  SIMD_SSE2,    ///< 16 байт за шаг (базовый x86-64)
+  SIMD_AVX2,    ///< 32 байта за шаг
+  SIMD_AVX512   ///< 64 байта за шаг (AVX-512BW)
+} SimdLevel;
+
+/**
+ * @brief Считает вхождения байта в буфере
+ * @param text буфер
+ * @param len длина буфера
+ * @param c байт
+ * @return количество вхождений
+ */
+size_t simd_count_byte(const char *text, size_t len, unsigned char c);
+
+/**
+ * @brief Ищет первый байт, равный a или b
+ * @param text буфер
+ * @param len длина буфера
+ * @param a первый байт
+ * @param b второй байт (может совпадать с a)
+ * @return указатель на найденный байт или NULL
+ */
+const char *simd_find_byte2(const char *text, size_t len, unsigned char a,
+                            unsigned char b);
+
+/**
+ * @brief Ищет первый байт вне печатаемого ASCII (32..126)
+ *
+ * К таким байтам относятся '\t', '\n', управляющие символы, 127 и байты
+ * от 128; все остальные выводятся cat без изменений при любых флагах.
+ * @param text буфер
+ * @param len длина буфера
+ * @return указатель на найденный байт или NULL
+ */
+const char *simd_find_special(const char *text, size_t len);
+
+/**
+ * @brief Выбранный при запуске уровень
+ *
+ * Уровень определяется один раз через cpuid (с учетом поддержки ОС) и
+ * может быть понижен переменной S21_SIMD=scalar|sse2|avx2|avx512.
+ * @return уровень
+ */
+SimdLevel simd_level(void);
+
+/**
+ * @brief Имя уровня для отчетов
+ * @param level уровень
+ * @return строка ("scalar", "sse2", "avx2", "avx512")
+ */
+const char *simd_level_name(SimdLevel level);
+
+#endif  // SIMD_H
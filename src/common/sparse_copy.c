@@ -0,0 +1,166 @@
+#define _GNU_SOURCE
+#include "sparse_copy.h"
+
+/**
+ * @brief Общий блок нулей для выходов, не поддерживающих дыры
+ */
+static const char zero_block[SPARSE_ZERO_SIZE];
+
+/**
+ * @brief Записывает буфер целиком
+ * @param copy состояние копирования
+ * @param buf буфер
+ * @param len длина буфера
+ */
+static void write_all(SparseCopy *copy, const char *buf, size_t len) {
+  while (len && copy->status == SUCCESS) {
+    ssize_t n = write(copy->out_fd, buf, len);
+    if (n < 0 && errno != EINTR) {
+      copy->status = FILE_ERROR;
+    } else if (n > 0) {
+      buf += n;
+      len -= n;
+    }
+  }
+  return;
+}
+
+/**
+ * @brief Считает, сколько байт дыры приходится на уже существующие данные
+ *
+ * Выход, открытый без O_TRUNC (например, 1<>file), может содержать старые
+ * данные за текущей позицией; сдвиг позиции оставил бы их вместо нулей.
+ * @param copy состояние копирования
+ * @param len длина дыры
+ * @return количество байт, которые нужно записать нулями
+ */
+static off_t hole_overlap(SparseCopy *copy, off_t len) {
+  struct stat st;
+  off_t overlap = 0;
+  off_t pos = lseek(copy->out_fd, 0, SEEK_CUR);
+  if (pos < 0 || fstat(copy->out_fd, &st) != 0) {
+    copy->status = FILE_ERROR;
+  } else if (st.st_size > pos) {
+    overlap = (st.st_size - pos) < len ? st.st_size - pos : len;
+  }
+  return overlap;
+}
+
+/**
+ * @brief Переносит дыру на выход
+ *
+ * Часть дыры за концом выхода пропускается сдвигом позиции, остальное
+ * записывается нулями.
+ * @param copy состояние копирования
+ * @param len длина дыры
+ */
+static void copy_hole(SparseCopy *copy, off_t len) {
+  off_t zeros = copy->seek_holes ? hole_overlap(copy, len) : len;
+  off_t skip = len - zeros;
+  while (zeros > 0 && copy->status == SUCCESS) {
+    size_t n = zeros < SPARSE_ZERO_SIZE ? (size_t)zeros : SPARSE_ZERO_SIZE;
+    write_all(copy, zero_block, n);
+    zeros -= n;
+  }
+  if (copy->seek_holes && copy->status == SUCCESS && skip > 0 &&
+      lseek(copy->out_fd, skip, SEEK_CUR) < 0) {
+    copy->status = FILE_ERROR;
+  }
+  return;
+}
+
+/**
+ * @brief Копирует часть экстента через pread/write
+ * @param copy состояние копирования
+ * @param want желаемое количество байт
+ * @return прочитано байт (0 - конец файла, -1 - ошибка)
+ */
+static ssize_t read_chunk(SparseCopy *copy, size_t want) {
+  char buffer[SPARSE_BUFFER_SIZE];
+  ssize_t n = pread(copy->in_fd, buffer,
+                    want < sizeof(buffer) ? want : sizeof(buffer),
+                    copy->in_pos);
+  if (n < 0 && errno != EINTR) {
+    copy->status = FILE_ERROR;
+  } else if (n > 0) {
+    write_all(copy, buffer, n);
+    copy->in_pos += n;
+  }
+  return n;
+}
+
+/**
+ * @brief Копирует данные входа до позиции end
+ * @param copy состояние копирования
+ * @param end конец экстента данных
+ */
+static void copy_data(SparseCopy *copy, off_t end) {
+  while (copy->in_pos < end && copy->status == SUCCESS) {
+    size_t want = (end - copy->in_pos) < SPARSE_CHUNK
+                      ? (size_t)(end - copy->in_pos)
+                      : SPARSE_CHUNK;
+    ssize_t n = -1;
+    if (copy->copy_range) {
+      n = copy_file_range(copy->in_fd, &copy->in_pos, copy->out_fd, NULL,
+                          want, 0);
+      if (n < 0) copy->copy_range = 0;
+    }
+    if (n < 0) n = read_chunk(copy, want);
+    if (n == 0) copy->in_pos = end;
+  }
+  return;
+}
+
+/**
+ * @brief Продлевает выход до текущей позиции, если файл кончается дырой
+ * @param copy состояние копирования
+ */
+static void finish_holes(SparseCopy *copy) {
+  struct stat st;
+  off_t pos = lseek(copy->out_fd, 0, SEEK_CUR);
+  if (pos < 0 || fstat(copy->out_fd, &st) != 0 ||
+      (pos > st.st_size && ftruncate(copy->out_fd, pos) != 0)) {
+    copy->status = FILE_ERROR;
+  }
+  return;
+}
+
+/**
+ * @brief Обходит экстенты данных и дыры входа
+ * @param copy состояние копирования
+ */
+static void copy_extents(SparseCopy *copy) {
+  while (copy->in_pos < copy->in_end && copy->status == SUCCESS) {
+    off_t data = lseek(copy->in_fd, copy->in_pos, SEEK_DATA);
+    if (data < 0) data = (errno == ENXIO) ? copy->in_end : copy->in_pos;
+    off_t hole = copy->in_end;
+    if (data < copy->in_end) hole = lseek(copy->in_fd, data, SEEK_HOLE);
+    if (hole < 0 || hole > copy->in_end) hole = copy->in_end;
+    if (data > copy->in_pos) {
+      copy_hole(copy, data - copy->in_pos);
+      copy->in_pos = data;
+    }
+    copy_data(copy, hole);
+  }
+  if (copy->seek_holes && copy->status == SUCCESS) finish_holes(copy);
+  return;
+}
+
+ErrorCode sparse_copy(int in_fd, int out_fd, off_t offset, int *copied) {
+  SparseCopy copy = {in_fd, out_fd, offset, 0, 0, 1, SUCCESS};
+  struct stat in_st;
+  struct stat out_st;
+  *copied = 0;
+  if (in_fd >= 0 && fstat(in_fd, &in_st) == 0 && S_ISREG(in_st.st_mode) &&
+      fstat(out_fd, &out_st) == 0) {
+    *copied = (lseek(in_fd, offset, SEEK_DATA) >= 0 || errno == ENXIO);
+  }
+  if (*copied) {
+    int flags = fcntl(out_fd, F_GETFL);
+    copy.in_end = in_st.st_size;
+    copy.seek_holes = S_ISREG(out_st.st_mode) && flags >= 0 &&
+                      !(flags & O_APPEND) && lseek(out_fd, 0, SEEK_CUR) >= 0;
+    copy_extents(&copy);
+  }
+  return copy.status;
+}
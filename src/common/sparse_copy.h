@@ -0,0 +1,49 @@
+#ifndef SPARSE_COPY_H
+#define SPARSE_COPY_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "error_codes.h"
+
+#define SPARSE_CHUNK (1024 * 1024)        ///< Максимум за один copy_file_range
+#define SPARSE_BUFFER_SIZE (64 * 1024)    ///< Буфер pread/write
+#define SPARSE_ZERO_SIZE (64 * 1024)      ///< Общий блок нулей
+
+/**
+ * @brief Состояние копирования по экстентам данных
+ */
+typedef struct {
+  int in_fd;         ///< Дескриптор входа
+  int out_fd;        ///< Дескриптор выхода
+  off_t in_pos;      ///< Текущая позиция во входе
+  off_t in_end;      ///< Размер входа
+  int seek_holes;    ///< Дыры переносятся сдвигом позиции выхода
+  int copy_range;    ///< copy_file_range еще не отказал
+  ErrorCode status;  ///< Код ошибки
+} SparseCopy;
+
+/**
+ * @brief Копирует обычный файл с позиции offset до конца, сохраняя дыры
+ *
+ * Экстенты данных находятся через SEEK_DATA/SEEK_HOLE и копируются
+ * copy_file_range (pread/write, если ядро или выход его не поддерживают).
+ * Если выход - обычный файл без O_APPEND, дыры за концом выхода
+ * воссоздаются сдвигом позиции и ftruncate, а части дыр, перекрывающие
+ * старые данные выхода, записываются нулями; в остальных случаях дыры
+ * записываются из общего блока нулей.
+ * Перед вызовом буфер stdio выхода должен быть сброшен.
+ * @param in_fd дескриптор входа
+ * @param out_fd дескриптор выхода
+ * @param offset начальная позиция во входе
+ * @param copied 1 если файл скопирован, 0 если вход не обычный файл или
+ * не поддерживает SEEK_DATA (тогда ничего не записано)
+ * @return Код ошибки
+ */
+ErrorCode sparse_copy(int in_fd, int out_fd, off_t offset, int *copied);
+
+#endif  // SPARSE_COPY_H
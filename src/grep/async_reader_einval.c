@@ -0,0 +1,60 @@
+/**
+ * @file async_reader_einval.c
+ * @brief Тестовая сборка конвейера чтения (make s21_grep_einval)
+ *
+ * Исходник конвейера подключается целиком и без изменений. Перехватываются
+ * только mmap (чтобы запомнить массив SQE) и syscall: перед каждым
+ * io_uring_enter все SQE получают неизвестную операцию, и ядро отвергает
+ * их с -EINVAL так же, как ядра до 5.6 отвергают openat/read.
+ */
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "../common/async_reader.h"
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+
+#define EINVAL_OPCODE 255  ///< Операция, неизвестная ядру
+
+static struct io_uring_sqe *einval_sqes = NULL;  ///< Массив SQE кольца
+static size_t einval_num_sqes = 0;               ///< Размер массива SQE
+
+/**
+ * @brief Запоминает отображение массива SQE
+ * @param ptr результат mmap
+ * @param size размер отображения
+ * @param offset смещение отображения
+ * @return ptr
+ */
+static void *einval_mmap(void *ptr, size_t size, off_t offset) {
+  if (ptr != MAP_FAILED && offset == (off_t)IORING_OFF_SQES) {
+    einval_sqes = ptr;
+    einval_num_sqes = size / sizeof(struct io_uring_sqe);
+  }
+  return ptr;
+}
+
+/**
+ * @brief Подменяет операции всех SQE перед io_uring_enter
+ * @param number номер системного вызова
+ * @return number
+ */
+static long einval_syscall(long number) {
+  if (number == __NR_io_uring_enter) {
+    for (size_t i = 0; i < einval_num_sqes; i++) {
+      einval_sqes[i].opcode = EINVAL_OPCODE;
+    }
+  }
+  return number;
+}
+
+#define mmap(addr, size, prot, flags, fd, offset) \
+  einval_mmap(mmap(addr, size, prot, flags, fd, offset), size, offset)
+#define syscall(number, ...) syscall(einval_syscall(number), __VA_ARGS__)
+#endif
+#endif
+
+#include "../common/async_reader.c"
@@ -0,0 +1,140 @@
+/**
+ * @file microbench_grep.c
+ * @brief Микробенчмарки внутренних функций s21_grep
+ *
+ * Исходник утилиты подключается целиком, чтобы замерять статические функции
+ * без изменения их видимости; main утилиты переименовывается.
+ */
+#define main s21_grep_main
+#include "s21_grep.c"
+#undef main
+
+#include "../common/microbench.h"
+
+/**
+ * @brief Данные для ядер grep
+ */
+typedef struct {
+  char **lines;      ///< Строки текста без '\n'
+  size_t num_lines;  ///< Количество строк
+  size_t bytes;      ///< Размер текста
+  GrepOptions opts;  ///< Настройки для ядра
+} GrepBench;
+
+/**
+ * @brief Ядро: сопоставление строк (process_line в режиме -c)
+ * @param ctx данные ядра
+ */
+static void bench_process_line(void *ctx) {
+  GrepBench *bench = ctx;
+  int match_count = 0;
+  for (size_t i = 0; i < bench->num_lines; i++) {
+    process_line(bench->lines[i], (int)i + 1, &bench->opts, "bench",
+                 &match_count);
+  }
+  return;
+}
+
+/**
+ * @brief Ядро: вывод префикса совпадения (handle_match_output -H -n)
+ * @param ctx данные ядра
+ */
+static void bench_match_output(void *ctx) {
+  GrepBench *bench = ctx;
+  for (size_t i = 0; i < bench->num_lines; i++) {
+    handle_match_output("bench.txt", (int)i + 1, &bench->opts);
+  }
+  return;
+}
+
+/**
+ * @brief Разбивает текст на строки на месте
+ * @param bench данные ядра
+ * @param text текст (символы '\n' заменяются на '\0')
+ * @param size размер текста
+ * @return 1 при успехе, 0 при ошибке памяти
+ */
+static int split_lines(GrepBench *bench, char *text, size_t size) {
+  size_t count = 0;
+  for (size_t i = 0; i < size; i++) count += (text[i] == '\n');
+  bench->lines = malloc((count + 1) * sizeof(char *));
+  bench->bytes = size;
+  for (size_t i = 0, start = 0; bench->lines && i < size; i++) {
+    if (text[i] == '\n') {
+      text[i] = '\0';
+      bench->lines[bench->num_lines++] = text + start;
+      start = i + 1;
+    }
+  }
+  return bench->lines != NULL;
+}
+
+/**
+ * @brief Готовит настройки grep для набора шаблонов
+ * @param bench данные ядра
+ * @param source данные с разбитыми строками
+ * @param patterns шаблоны
+ * @param num_patterns количество шаблонов
+ * @return Код ошибки
+ */
+static ErrorCode setup_bench(GrepBench *bench, const GrepBench *source,
+                             const char *const *patterns,
+                             size_t num_patterns) {
+  ErrorCode status = SUCCESS;
+  *bench = *source;
+  bench->opts = (GrepOptions){0};
+  bench->opts.program_name = "microbench_grep";
+  bench->opts.count_only = 1;
+  bench->opts.out = stdout;
+  bench->opts.err = stderr;
+  for (size_t i = 0; i < num_patterns && status == SUCCESS; i++) {
+    status = pattern_store_add(&bench->opts.patterns, patterns[i],
+                               strlen(patterns[i]));
+  }
+  if (status == SUCCESS) {
+    setup_matching(&bench->opts);
+    status = compile_patterns(&bench->opts);
+  }
+  return status;
+}
+
+int main(int argc, char **argv) {
+  static const char *const regex[] = {"[0-9][0-9] [a-z]*q"};
+  static const char *const literal[] = {"quux"};
+  static const char *const literals[] = {"quux", "Zebra", "42 x", "ok!"};
+  int status = 1;
+  char *text = bench_generate_text(BENCH_INPUT_SIZE, 21);
+  GrepBench source = {0};
+  GrepBench benches[4] = {0};
+
+  if (argc > 1 && argv[1][0] == '-') {
+    status = bench_tool(argc, argv, "s21_grep");
+  } else if (text && split_lines(&source, text, BENCH_INPUT_SIZE) &&
+      setup_bench(&benches[0], &source, regex, 1) == SUCCESS &&
+      setup_bench(&benches[1], &source, literal, 1) == SUCCESS &&
+      setup_bench(&benches[2], &source, literals, 4) == SUCCESS &&
+      setup_bench(&benches[3], &source, literals, 4) == SUCCESS) {
+    GrepBench prefix = source;
+    benches[3].opts.use_automaton = 0;
+    prefix.opts.print_filename = prefix.opts.line_number = 1;
+    prefix.opts.out = stdout;
+    BenchCase cases[] = {
+        {"process_line_regex", bench_process_line, &benches[0],
+         source.bytes, source.num_lines},
+        {"process_line_literal", bench_process_line, &benches[1],
+         source.bytes, source.num_lines},
+        {"process_line_automaton", bench_process_line, &benches[2],
+         source.bytes, source.num_lines},
+        {"process_line_literal_set", bench_process_line, &benches[3],
+         source.bytes, source.num_lines},
+        {"handle_match_output", bench_match_output, &prefix, 0,
+         source.num_lines}};
+    status = bench_suite("s21_grep", argc > 1 ? argv[1] : "unknown", cases,
+                         sizeof(cases) / sizeof(cases[0]));
+  }
+
+  for (int i = 0; i < 4; i++) cleanup_resources(&benches[i].opts);
+  free(source.lines);
+  free(text);
+  return status;
+}
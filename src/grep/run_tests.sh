@@ -29,6 +29,7 @@ echo -e "\x00\x01\x02test" > $TEST_DATA_DIR/binary2.bin
 echo "test" > $TEST_DATA_DIR/empty_line.txt
 echo -n "no newline" > $TEST_DATA_DIR/no_newline.txt
 echo -e "Hello\nTEST" > $TEST_DATA_DIR/multi_pattern.txt
+echo -e "line\nHello\nline\ntest\nHello" > $TEST_DATA_DIR/dup_pattern.txt
 echo "" > $TEST_DATA_DIR/empty_pattern.txt
 echo "ThisIsAReallyLongLineWithPattern_$(printf '%*s' 5000 | tr ' ' 'A')" > $TEST_DATA_DIR/long_line.txt
 echo "$(printf '%*s' 5000 | tr ' ' 'A')" > $TEST_DATA_DIR/long_pattern.txt
@@ -36,7 +37,10 @@ echo "test test test" > $TEST_DATA_DIR/multi_match.txt
 echo -n -e "\x00\x00\x00" > $TEST_DATA_DIR/all_null.bin
 echo -e "text\x00with\x00null" > $TEST_DATA_DIR/null_bytes.txt
 echo "СЪешь ещё этих мягких французских булок" > $TEST_DATA_DIR/unicode.txt
+{ cat $TEST_DATA_DIR/file1.txt; printf '%*s' 1500000 | tr ' ' 'A'; echo " test"
+  cat $TEST_DATA_DIR/file2.txt; echo -n "last test"; } > $TEST_DATA_DIR/count_big.txt
 touch $TEST_DATA_DIR/empty.txt
+mkdir -p $TEST_DATA_DIR/subdir
 cp $TEST_DATA_DIR/file1.txt "$TEST_DATA_DIR/file with spaces.txt"
 chmod 000 $TEST_DATA_DIR/protected.txt 2>/dev/null || true
 
@@ -93,6 +97,16 @@ run_test "long_line" "Pattern $TEST_DATA_DIR/long_line.txt"
 run_test "long_pattern" "-f $TEST_DATA_DIR/long_pattern.txt $TEST_DATA_DIR/long_line.txt"
 run_test "empty_pattern" "-f $TEST_DATA_DIR/empty_pattern.txt $TEST_DATA_DIR/file1.txt"
 run_test "multi_pattern" "-f $TEST_DATA_DIR/multi_pattern.txt $TEST_DATA_DIR/file1.txt"
+run_test "dup_pattern" "-o -f $TEST_DATA_DIR/dup_pattern.txt $TEST_DATA_DIR/file1.txt $TEST_DATA_DIR/file2.txt"
+run_test "dup_pattern_i" "-i -c -f $TEST_DATA_DIR/dup_pattern.txt $TEST_DATA_DIR/file1.txt $TEST_DATA_DIR/file2.txt"
+run_test "count_literal_v" "-c -v test $TEST_DATA_DIR/count_big.txt"
+run_test "count_multi_v" "-c -v -i -e hello -e test $TEST_DATA_DIR/count_big.txt"
+run_test "count_literal_set" "-c -e test -e line -e TEST $TEST_DATA_DIR/file1.txt $TEST_DATA_DIR/file2.txt"
+run_test "literal_set_v" "-n -v -e test -e line -e aaa $TEST_DATA_DIR/file1.txt $TEST_DATA_DIR/file2.txt"
+run_test "count_regex_huge_line" "-c t[e]st $TEST_DATA_DIR/count_big.txt $TEST_DATA_DIR/file2.txt"
+run_test "window_long_line" "-n test $TEST_DATA_DIR/count_big.txt"
+run_test "window_long_line_v" "-v -e Hello -e A $TEST_DATA_DIR/count_big.txt"
+run_test "window_l" "-l test $TEST_DATA_DIR/count_big.txt $TEST_DATA_DIR/file1.txt"
 run_test "binary_test" "abc $TEST_DATA_DIR/binary_test.bin"
 run_test "invalid_pattern_file" "-f invalid.txt $TEST_DATA_DIR/file1.txt"
 run_test "no_newline" "no $TEST_DATA_DIR/no_newline.txt"
@@ -115,6 +129,164 @@ run_test "all_null_file" "pattern $TEST_DATA_DIR/all_null.bin"
 run_test "unreadable_file" "-s test $TEST_DATA_DIR/protected.txt"
 run_test "edge_pattern" "-e ^a*$ $TEST_DATA_DIR/file1.txt"
 run_test "unicode_case" "-i -o съешь $TEST_DATA_DIR/unicode.txt"
+run_test "unicode_dot" "-o с.ешь $TEST_DATA_DIR/unicode.txt"
+run_test "literal_icase" "-i -o -e hello -e te $TEST_DATA_DIR/file1.txt $TEST_DATA_DIR/file2.txt"
+run_test "v_multi_pattern" "-v -e Hello -e TEST $TEST_DATA_DIR/file1.txt"
+
+######################################### Уровни SIMD ##############################################
+# Совпадения и переводы строк попадают на разные смещения внутри векторов
+for i in $(seq 1 300); do
+    printf '%*s' $((i % 131)) | tr ' ' 'x'
+    [ $((i % 3)) -eq 0 ] && printf 'test'
+    printf ' line %d\n' $i
+done > $TEST_DATA_DIR/simd_lines.txt
+{ printf '%*s' 700 | tr ' ' 'a'; printf 'test\0\001test\n'; } > $TEST_DATA_DIR/simd_binary.bin
+run_simd_test() {
+    local test_name=$1
+    local grep_args="$2"
+    local level
+    grep $grep_args > "$EXPECTED_DIR/${test_name}_expected.txt" 2>&1 || true
+    for level in scalar sse2 avx2 avx512; do
+        echo -n "Running ${test_name}_$level..."
+        S21_SIMD=$level ./grep $grep_args > "$OUTPUT_DIR/${test_name}_${level}_output.txt" 2>&1 || true
+        diff -u "$EXPECTED_DIR/${test_name}_expected.txt" "$OUTPUT_DIR/${test_name}_${level}_output.txt" || exit 1
+        echo -e "\033[32mOK!\033[0m"
+    done
+}
+run_simd_test "simd_c" "-c test $TEST_DATA_DIR/simd_lines.txt $TEST_DATA_DIR/count_big.txt"
+run_simd_test "simd_c_v" "-c -v test $TEST_DATA_DIR/simd_lines.txt $TEST_DATA_DIR/count_big.txt"
+run_simd_test "simd_v" "-n -v test $TEST_DATA_DIR/simd_lines.txt"
+run_simd_test "simd_binary" "test $TEST_DATA_DIR/simd_binary.bin $TEST_DATA_DIR/simd_lines.txt"
+
+######################################### Режим сервера ###########################################
+echo -n "Running serve_client..."
+SOCKET="$TEST_DATA_DIR/grep.sock"
+./grep -n -i -e hello -e test --serve $SOCKET &
+SERVER_PID=$!
+for i in $(seq 50); do [ -S $SOCKET ] && break; sleep 0.1; done
+grep -n -i -e hello -e test $TEST_DATA_DIR/file1.txt $TEST_DATA_DIR/file2.txt > "$EXPECTED_DIR/serve_client_expected.txt" 2>&1 || true
+./grep --client $SOCKET $TEST_DATA_DIR/file1.txt $TEST_DATA_DIR/file2.txt > "$OUTPUT_DIR/serve_client_output.txt" 2>&1 || true
+grep -n -i -e hello -e test < $TEST_DATA_DIR/file2.txt >> "$EXPECTED_DIR/serve_client_expected.txt" 2>&1 || true
+./grep --client $SOCKET < $TEST_DATA_DIR/file2.txt >> "$OUTPUT_DIR/serve_client_output.txt" 2>&1 || true
+kill $SERVER_PID
+wait $SERVER_PID || true
+diff -u "$EXPECTED_DIR/serve_client_expected.txt" "$OUTPUT_DIR/serve_client_output.txt" || exit 1
+echo -e "\033[32mOK!\033[0m"
+
+echo -n "Running serve_client_regex..."
+./grep -c -e "[0-9]" -e "^a" --serve $SOCKET &
+SERVER_PID=$!
+for i in $(seq 50); do [ -S $SOCKET ] && break; sleep 0.1; done
+grep -c -e "[0-9]" -e "^a" $TEST_DATA_DIR/file1.txt $TEST_DATA_DIR/file2.txt > "$EXPECTED_DIR/serve_client_regex_expected.txt" 2>&1 || true
+./grep --client $SOCKET $TEST_DATA_DIR/file1.txt $TEST_DATA_DIR/file2.txt > "$OUTPUT_DIR/serve_client_regex_output.txt" 2>&1 || true
+kill $SERVER_PID
+wait $SERVER_PID || true
+diff -u "$EXPECTED_DIR/serve_client_regex_expected.txt" "$OUTPUT_DIR/serve_client_regex_output.txt" || exit 1
+echo -e "\033[32mOK!\033[0m"
+
+# Ошибки обработки файла в рабочем потоке выводятся в stderr клиента
+echo -n "Running serve_client_errors..."
+./grep test --serve $SOCKET 2> "$OUTPUT_DIR/serve_server_errors.txt" &
+SERVER_PID=$!
+for i in $(seq 50); do [ -S $SOCKET ] && break; sleep 0.1; done
+./grep test $TEST_DATA_DIR/subdir > /dev/null 2> "$EXPECTED_DIR/serve_client_errors_expected.txt" || true
+./grep --client $SOCKET $TEST_DATA_DIR/subdir > /dev/null 2> "$OUTPUT_DIR/serve_client_errors_output.txt" || true
+kill $SERVER_PID
+wait $SERVER_PID || true
+diff -u "$EXPECTED_DIR/serve_client_errors_expected.txt" "$OUTPUT_DIR/serve_client_errors_output.txt" || exit 1
+[ -s "$OUTPUT_DIR/serve_client_errors_output.txt" ] || exit 1
+[ ! -s "$OUTPUT_DIR/serve_server_errors.txt" ] || exit 1
+echo -e "\033[32mOK!\033[0m"
+
+######################################### Кэш автоматов ############################################
+echo -n "Running automaton_cache..."
+CACHE_DIR="$TEST_DATA_DIR/cache"
+rm -rf $CACHE_DIR && mkdir -p $CACHE_DIR
+{ seq -f "word%g" 1100; echo Hello; echo test; } > $TEST_DATA_DIR/many_patterns.txt
+grep -n -f $TEST_DATA_DIR/many_patterns.txt $TEST_DATA_DIR/file1.txt $TEST_DATA_DIR/file2.txt > "$EXPECTED_DIR/automaton_cache_expected.txt" 2>&1 || true
+S21_GREP_CACHE_DIR=$CACHE_DIR ./grep -n -f $TEST_DATA_DIR/many_patterns.txt $TEST_DATA_DIR/file1.txt $TEST_DATA_DIR/file2.txt > "$OUTPUT_DIR/automaton_cache_output.txt" 2>&1 || true
+diff -u "$EXPECTED_DIR/automaton_cache_expected.txt" "$OUTPUT_DIR/automaton_cache_output.txt" || exit 1
+for cache in $CACHE_DIR/*; do
+    printf '\377%.0s' $(seq 4096) | dd of=$cache bs=1 seek=1200 conv=notrunc status=none
+done
+S21_GREP_CACHE_DIR=$CACHE_DIR ./grep -n -f $TEST_DATA_DIR/many_patterns.txt $TEST_DATA_DIR/file1.txt $TEST_DATA_DIR/file2.txt > "$OUTPUT_DIR/automaton_cache_output.txt" 2>&1 || true
+diff -u "$EXPECTED_DIR/automaton_cache_expected.txt" "$OUTPUT_DIR/automaton_cache_output.txt" || exit 1
+# Кэш, доступный для записи другим, не используется и пересоздается с правами 0600
+chmod 666 $CACHE_DIR/*
+S21_GREP_CACHE_DIR=$CACHE_DIR ./grep -n -f $TEST_DATA_DIR/many_patterns.txt $TEST_DATA_DIR/file1.txt $TEST_DATA_DIR/file2.txt > "$OUTPUT_DIR/automaton_cache_output.txt" 2>&1 || true
+diff -u "$EXPECTED_DIR/automaton_cache_expected.txt" "$OUTPUT_DIR/automaton_cache_output.txt" || exit 1
+[ "$(stat -c %a $CACHE_DIR/*)" = "600" ] || exit 1
+echo -e "\033[32mOK!\033[0m"
+
+######################################### Маршруты (--route) #######################################
+printf "test\nHello\n" > $TEST_DATA_DIR/route_literal.txt
+printf "[0-9]\n^a\n" > $TEST_DATA_DIR/route_regex.txt
+run_route_test() {
+    local test_name=$1
+    local flags="$2"
+    shift 2
+    local routes=()
+    local route
+    echo -n "Running $test_name..."
+    for route in "$@"; do
+        rm -f "$OUTPUT_DIR/${test_name}_${route}.txt"
+        routes+=(--route "$TEST_DATA_DIR/$route.txt=$OUTPUT_DIR/${test_name}_${route}.txt")
+    done
+    ./grep $flags "${routes[@]}" $TEST_DATA_DIR/file1.txt $TEST_DATA_DIR/file2.txt || exit 1
+    for route in "$@"; do
+        grep $flags -f $TEST_DATA_DIR/$route.txt $TEST_DATA_DIR/file1.txt $TEST_DATA_DIR/file2.txt > "$EXPECTED_DIR/${test_name}_${route}.txt" || true
+        diff -u "$EXPECTED_DIR/${test_name}_${route}.txt" "$OUTPUT_DIR/${test_name}_${route}.txt" || exit 1
+    done
+    echo -e "\033[32mOK!\033[0m"
+}
+run_route_test "route_literal" "-n" "route_literal" "multi_pattern"
+run_route_test "route_icase_v" "-i -v" "route_literal" "patterns"
+run_route_test "route_regex" "-h" "route_regex" "route_literal"
+echo -n "Running route_shared_output..."
+rm -f "$OUTPUT_DIR/route_shared_output.txt"
+./grep -n --route $TEST_DATA_DIR/route_literal.txt="$OUTPUT_DIR/route_shared_output.txt" --route $TEST_DATA_DIR/multi_pattern.txt="$OUTPUT_DIR/route_shared_output.txt" $TEST_DATA_DIR/file1.txt $TEST_DATA_DIR/file2.txt || exit 1
+grep -n -f $TEST_DATA_DIR/route_literal.txt -f $TEST_DATA_DIR/multi_pattern.txt $TEST_DATA_DIR/file1.txt $TEST_DATA_DIR/file2.txt > "$EXPECTED_DIR/route_shared_output.txt" || true
+diff -u "$EXPECTED_DIR/route_shared_output.txt" "$OUTPUT_DIR/route_shared_output.txt" || exit 1
+echo -e "\033[32mOK!\033[0m"
+if [ -w /dev/full ]; then
+    echo -n "Running route_write_error..."
+    ./grep --route $TEST_DATA_DIR/route_literal.txt=/dev/full $TEST_DATA_DIR/file1.txt 2> /dev/null && exit 1
+    echo -e "\033[32mOK!\033[0m"
+fi
+
+######################################### Откат io_uring ###########################################
+echo -n "Running uring_unsupported..."
+make -s s21_grep_einval > /dev/null
+URING_FILES="$TEST_DATA_DIR/file1.txt $TEST_DATA_DIR/file2.txt $TEST_DATA_DIR/invalid.txt"
+grep -n test $URING_FILES > "$EXPECTED_DIR/uring_unsupported_expected.txt" 2> "$EXPECTED_DIR/uring_unsupported_errors.txt" || true
+./s21_grep_einval -n test $URING_FILES > "$OUTPUT_DIR/uring_unsupported_output.txt" 2> "$OUTPUT_DIR/uring_unsupported_errors.txt" || true
+sed -i 's/^s21_grep_einval:/grep:/' "$OUTPUT_DIR/uring_unsupported_errors.txt"
+diff -u "$EXPECTED_DIR/uring_unsupported_expected.txt" "$OUTPUT_DIR/uring_unsupported_output.txt" || exit 1
+diff -u "$EXPECTED_DIR/uring_unsupported_errors.txt" "$OUTPUT_DIR/uring_unsupported_errors.txt" || exit 1
+echo -e "\033[32mOK!\033[0m"
+
+######################################### Конвейер стандартного ввода ##############################
+echo -n "Running stdin_pipeline..."
+cat $TEST_DATA_DIR/file1.txt $TEST_DATA_DIR/file2.txt | grep -n line > "$EXPECTED_DIR/stdin_pipeline_expected.txt" 2>&1 || true
+cat $TEST_DATA_DIR/file1.txt $TEST_DATA_DIR/file2.txt | S21_PIPELINE=1 ./grep -n line > "$OUTPUT_DIR/stdin_pipeline_output.txt" 2>&1 || true
+diff -u "$EXPECTED_DIR/stdin_pipeline_expected.txt" "$OUTPUT_DIR/stdin_pipeline_output.txt" || exit 1
+echo -e "\033[32mOK!\033[0m"
+
+# Совпавшая строка длиннее окна (1 МБ) из канала выводится целиком
+run_pipe_long_line_test() {
+    local test_name=$1
+    local pipeline=$2
+    local flags="$3"
+    echo -n "Running $test_name..."
+    cat $TEST_DATA_DIR/count_big.txt | grep $flags > "$EXPECTED_DIR/${test_name}_expected.txt" 2>&1 || true
+    cat $TEST_DATA_DIR/count_big.txt | S21_PIPELINE=$pipeline ./grep $flags > "$OUTPUT_DIR/${test_name}_output.txt" 2>&1 || true
+    diff -q "$EXPECTED_DIR/${test_name}_expected.txt" "$OUTPUT_DIR/${test_name}_output.txt" || exit 1
+    echo -e "\033[32mOK!\033[0m"
+}
+run_pipe_long_line_test "pipe_long_line" 0 "-n test"
+run_pipe_long_line_test "pipe_long_line_set" 0 "-e Hello -e test -e A"
+run_pipe_long_line_test "pipeline_long_line" 1 "-n test"
+run_pipe_long_line_test "pipe_long_line_count" 0 "-c test"
 
 echo -e "\n"
 ######################################### Тест на стиль ###########################################
@@ -1,34 +1,52 @@
 #include "s21_grep.h"
 
 int main(int argc, char **argv) {
-  setlocale(LC_ALL, "");
   GrepOptions opts = {0};
   ErrorCode status = SUCCESS;
+  int exit_status = 0;
   opts.program_name = basename(argv[0]);
+  opts.out = stdout;
+  opts.err = stderr;
 
   if ((status = process_arguments(argc, argv, &opts)) == SUCCESS &&
-      (status = compile_patterns(&opts)) == SUCCESS) {
+      opts.client_socket) {
+    status = serve_client(opts.client_socket, argc - optind, argv + optind,
+                          opts.program_name, &exit_status);
+  } else if (status == SUCCESS) {
+    setup_matching(&opts);
+    status = compile_patterns(&opts);
+    if (status == SUCCESS && opts.num_routes) status = open_routes(&opts);
+  }
+
+  if (status == SUCCESS && opts.serve_socket) {
+    ServeHandler handler = {grep_serve_worker_begin, grep_serve_worker_end,
+                            grep_serve_begin, grep_serve_file,
+                            grep_serve_end};
+    status = serve_requests(opts.serve_socket, &opts, &handler,
+                            opts.program_name);
+  } else if (status == SUCCESS && !opts.client_socket) {
     if (optind == argc) {
       process_file("(standard input)", &opts);
     } else {
       opts.print_filename =
           ((argc - optind > 1 && !opts.print_without_filename) ||
            opts.files_with_matches);
-      for (int i = optind; i < argc; i++) {
-        process_file(strcmp(argv[i], "-") == 0 ? "(standard input)" : argv[i],
-                     &opts);
-      }
+      process_files(argc - optind, argv + optind, &opts);
     }
+    if (opts.num_routes) status = close_routes(&opts);
   }
 
   cleanup_resources(&opts);
-  return status;
+  return status == SUCCESS ? (ErrorCode)exit_status : status;
 }
 
 static ErrorCode process_arguments(int argc, char **argv, GrepOptions *opts) {
   ErrorCode status = process_flags(argc, argv, opts);
 
-  if (status == SUCCESS && opts->num_patterns == 0 && optind < argc) {
+  if (status == SUCCESS && opts->num_routes) {
+    status = load_routes(opts);
+  } else if (status == SUCCESS && opts->patterns.count == 0 &&
+             optind < argc && !opts->client_socket) {
     status = handle_flag_e(opts, argv[optind++]);
   }
 
@@ -46,11 +64,29 @@ static ErrorCode process_arguments(int argc, char **argv, GrepOptions *opts) {
 }
 
 static ErrorCode process_flags(int argc, char **argv, GrepOptions *opts) {
+  static const struct option long_options[] = {
+      {"serve", required_argument, NULL, OPT_SERVE},
+      {"client", required_argument, NULL, OPT_CLIENT},
+      {"route", required_argument, NULL, OPT_ROUTE},
+      {NULL, 0, NULL, 0}};
   int opt;
   ErrorCode status = SUCCESS;
-  while ((opt = getopt(argc, argv, "e:ivclnhsf:o")) != -1 &&
+  while ((opt = getopt_long(argc, argv, "e:ivclnhsf:o", long_options,
+                            NULL)) != -1 &&
          status == SUCCESS) {
     switch (opt) {
+      case OPT_SERVE: {
+        opts->serve_socket = optarg;
+        break;
+      }
+      case OPT_CLIENT: {
+        opts->client_socket = optarg;
+        break;
+      }
+      case OPT_ROUTE: {
+        status = add_route(opts, optarg);
+        break;
+      }
       case 'e': {
         status = handle_flag_e(opts, optarg);
         break;
@@ -84,7 +120,7 @@ static ErrorCode process_flags(int argc, char **argv, GrepOptions *opts) {
         break;
       }
       case 'f': {
-        status = read_patterns_from_file(opts, optarg);
+        status = read_patterns_from_file(opts, optarg, 0);
         break;
       }
       case 'o': {
@@ -101,24 +137,65 @@ static ErrorCode process_flags(int argc, char **argv, GrepOptions *opts) {
 
 static void process_file(const char *filename, GrepOptions *opts) {
   FILE *fp = NULL;
+  PipeReader pipe = {0};
 
   if (strcmp(filename, "(standard input)") == 0) {
-    fp = stdin;
+    if (pipe_reader_enabled(STDIN_FILENO)) {
+      fp = pipe_reader_open(&pipe, STDIN_FILENO);
+    }
+    if (!fp) fp = stdin;
   } else {
     fp = fopen(filename, "rb");
   }
 
+  process_stream(fp, filename, opts);
+  if (pipe.stream) {
+    pipe_reader_close(&pipe);
+  } else if (fp && fp != stdin) {
+    fclose(fp);
+  }
+  return;
+}
+
+static void process_files(int num_files, char **files, GrepOptions *opts) {
+  AsyncReader reader;
+  AsyncFile *file = NULL;
+  async_reader_open(&reader, files, num_files);
+  while (async_reader_next(&reader, &file)) {
+    const char *filename = strcmp(file->filename, "-") == 0
+                               ? "(standard input)"
+                               : file->filename;
+    FILE *fp = file->data ? fmemopen(file->data, file->size, "rb") : NULL;
+    if (fp) {
+      process_stream(fp, filename, opts);
+      fclose(fp);
+    } else if (file->error) {
+      process_stream(NULL, filename, opts);
+    } else {
+      process_file(filename, opts);
+    }
+    async_reader_release(&reader);
+  }
+  async_reader_close(&reader);
+  return;
+}
+
+static void process_stream(FILE *fp, const char *filename, GrepOptions *opts) {
   if (fp) {
-    if (fp != stdin) processing_binary(fp, opts, filename);
+    opts->binary_file = 0;
+    if (strcmp(filename, "(standard input)") != 0) {
+      processing_binary(fp, opts, filename);
+    }
 
-    if (!opts->binary_file) {
+    if (!opts->binary_file && use_block_search(opts)) {
+      block_search(fp, opts, filename);
+    } else if (!opts->binary_file) {
       search(fp, opts, filename);
     }
-
-    if (fp != stdin) fclose(fp);
   } else {
     if (!opts->suppress_error) {
-      print_error(opts->program_name, filename, "No such file or directory");
+      fprint_error(opts->err, opts->program_name, filename,
+                   "No such file or directory");
     }
   }
   return;
@@ -142,7 +219,8 @@ static void search(FILE *file, GrepOptions *opts, const char *filename) {
       process_line(buffer, line_num, opts, filename, &match_count);
     } else {
       if (!opts->suppress_error)
-        print_error(opts->program_name, filename, "Error reading file");
+        fprint_error(opts->err, opts->program_name, filename,
+                     "Error reading file");
       status = FILE_ERROR;
     }
   }
@@ -153,12 +231,178 @@ static void search(FILE *file, GrepOptions *opts, const char *filename) {
   return;
 }
 
+static int use_block_search(const GrepOptions *opts) {
+  return opts->count_only || opts->files_with_matches ||
+         (can_count_raw(opts) && !opts->output_the_matched &&
+          !opts->num_routes);
+}
+
+static void block_search(FILE *file, GrepOptions *opts, const char *filename) {
+  SearchWindow win = {0};
+  win.capacity = SEARCH_WINDOW_SIZE;
+  win.buffer = malloc(win.capacity + 1);
+  win.status = win.buffer ? SUCCESS : MEMORY_ERROR;
+  win.done = (win.buffer == NULL);
+
+  while (!win.done) {
+    win.filled += fread(win.buffer + win.filled, 1,
+                        win.capacity - win.filled, file);
+    win.done = (win.filled < win.capacity);
+    size_t used = win.long_line ? feed_long_line(&win, file, opts, filename)
+                                : 0;
+    used += search_lines(&win, used, opts, filename);
+    memmove(win.buffer, win.buffer + used, win.filled - used);
+    win.filled -= used;
+    if (!win.done && win.filled == win.capacity) {
+      extend_window(&win, file, opts, filename);
+    }
+    if (opts->files_with_matches && win.match_count) win.done = 1;
+  }
+
+  if (win.status == SUCCESS && ferror(file)) win.status = FILE_ERROR;
+  if (win.status != SUCCESS) {
+    if (!opts->suppress_error)
+      fprint_error(opts->err, opts->program_name, filename,
+                   win.status == FILE_ERROR ? "Error reading file" : "malloc");
+  } else if (win.match_count) {
+    print_final_count(win.match_count, opts, filename);
+  }
+  free(win.buffer);
+  return;
+}
+
+static size_t search_lines(SearchWindow *win, size_t offset,
+                           GrepOptions *opts, const char *filename) {
+  char *text = win->buffer + offset;
+  size_t avail = win->filled - offset;
+  const char *newline = memrchr(text, '\n', avail);
+  size_t len = newline ? (size_t)(newline - text) + 1 : 0;
+  if (win->done) len = avail;
+
+  if ((opts->count_only || opts->files_with_matches) && can_count_raw(opts)) {
+    win->match_count += count_block(text, len, opts);
+  } else {
+    int count = 0;
+    if (len && text[len - 1] != '\n') text[len] = '\0';
+    for (char *line = text; line < text + len;) {
+      char *end = memchr(line, '\n', text + len - line);
+      if (end) *end = '\0';
+      process_line(line, (int)++win->line_num, opts, filename, &count);
+      line = end ? end + 1 : text + len;
+    }
+    win->match_count += count;
+  }
+  return len;
+}
+
+static size_t count_block(const char *text, size_t len,
+                          const GrepOptions *opts) {
+  size_t count =
+      opts->patterns.count > 1
+          ? ac_count_lines(&opts->automaton, text, len, opts->fold)
+          : literal_count_lines(text, len,
+                                pattern_store_get(&opts->patterns, 0),
+                                opts->patterns.lengths[0],
+                                opts->ignore_case ? opts->fold : NULL);
+  if (opts->invert_match) {
+    size_t lines = simd_count_byte(text, len, '\n');
+    lines += (len && text[len - 1] != '\n');
+    count = lines - count;
+  }
+  return count;
+}
+
+static void extend_window(SearchWindow *win, FILE *file, GrepOptions *opts,
+                          const char *filename) {
+  off_t position = can_count_raw(opts) ? ftello(file) : -1;
+  if (can_count_raw(opts) &&
+      (position >= 0 || opts->count_only || opts->files_with_matches)) {
+    win->long_line = 1;
+    win->state = 0;
+    win->stopped = 0;
+    win->line_start = position >= 0 ? position - (off_t)win->filled : -1;
+    win->filled -= feed_long_line(win, file, opts, filename);
+  } else {
+    char *grown = realloc(win->buffer, win->capacity * 2 + 1);
+    if (grown) {
+      win->buffer = grown;
+      win->capacity *= 2;
+    } else {
+      win->status = MEMORY_ERROR;
+      win->done = 1;
+    }
+  }
+  return;
+}
+
+static size_t feed_long_line(SearchWindow *win, FILE *file,
+                             GrepOptions *opts, const char *filename) {
+  const AcAutomaton *ac = &opts->automaton;
+  const char *newline = memchr(win->buffer, '\n', win->filled);
+  size_t len = newline ? (size_t)(newline - win->buffer) : win->filled;
+  if (!win->stopped && !ac->output[win->state]) {
+    size_t used = ac_feed(ac, &win->state, win->buffer, len, opts->fold);
+    win->stopped = (used < len && !ac->output[win->state]);
+  }
+
+  if (newline || win->done) {
+    int matched = ac->output[win->state] ^ opts->invert_match;
+    win->long_line = 0;
+    win->line_num++;
+    win->match_count += matched;
+    if (matched && !opts->count_only && !opts->files_with_matches) {
+      print_long_line(win, file, opts, filename);
+    }
+  }
+  return newline ? len + 1 : len;
+}
+
+static void print_long_line(const SearchWindow *win, FILE *file,
+                            const GrepOptions *opts, const char *filename) {
+  off_t resume = ftello(file);
+  if (win->line_start < 0 || resume < 0 ||
+      fseeko(file, win->line_start, SEEK_SET) != 0) {
+    if (!opts->suppress_error) {
+      char message[MAX_ERROR_MSG];
+      snprintf(message, sizeof(message),
+               "matched line exceeds %d bytes on unseekable input",
+               SEARCH_WINDOW_SIZE);
+      fprint_error(opts->err, opts->program_name, filename, message);
+    }
+  } else {
+    char chunk[4096];
+    size_t bytes = 0;
+    size_t len = 0;
+    handle_match_output(filename, (int)win->line_num, opts);
+    while (len == bytes && (bytes = fread(chunk, 1, sizeof(chunk), file))) {
+      const char *end = memchr(chunk, '\n', bytes);
+      len = end ? (size_t)(end - chunk) : bytes;
+      end = memchr(chunk, '\0', len);
+      len = end ? (size_t)(end - chunk) : len;
+      fwrite(chunk, 1, len, opts->out);
+    }
+    putc('\n', opts->out);
+    fseeko(file, resume, SEEK_SET);
+  }
+  return;
+}
+
+static int can_count_raw(const GrepOptions *opts) {
+  int raw = opts->literal_match;
+  for (size_t i = 0; i < opts->patterns.count && raw; i++) {
+    raw = !memchr(pattern_store_get(&opts->patterns, i), '\n',
+                  opts->patterns.lengths[i]);
+  }
+  return raw;
+}
+
 static void process_line(const char *buffer, int line_num, GrepOptions *opts,
                          const char *filename, int *match_count) {
   int found = 0;
-  for (size_t i = 0; i < opts->num_regexes && !found; i++) {
-    found = (regexec(&opts->regexes[i], buffer, 0, NULL, 0) == 0) ^
-            opts->invert_match;
+  if (opts->num_routes) {
+    route_line(buffer, line_num, opts, filename);
+  } else {
+    found = match_line(buffer, opts);
   }
   *match_count += found;
 
@@ -167,7 +411,7 @@ static void process_line(const char *buffer, int line_num, GrepOptions *opts,
       process_matches(buffer, opts, line_num, filename);
     } else {
       handle_match_output(filename, line_num, opts);
-      print_plain_line(buffer);
+      print_plain_line(buffer, opts);
     }
   }
 
@@ -177,29 +421,29 @@ static void process_line(const char *buffer, int line_num, GrepOptions *opts,
 static void handle_match_output(const char *filename, int line_num,
                                 const GrepOptions *opts) {
   if (opts->print_filename) {
-    printf("%s:", filename);
+    fprintf(opts->out, "%s:", filename);
   }
 
   if (opts->line_number) {
-    printf("%d:", line_num);
+    fprintf(opts->out, "%d:", line_num);
   }
 
   return;
 }
 
-static void print_final_count(int match_count, const GrepOptions *opts,
+static void print_final_count(size_t match_count, const GrepOptions *opts,
                               const char *filename) {
   if (!opts->count_only && !opts->files_with_matches) return;
 
   if (opts->print_filename) {
-    printf("%s", filename);
+    fprintf(opts->out, "%s", filename);
   }
 
   if (opts->files_with_matches) {
-    putchar('\n');
+    putc('\n', opts->out);
   } else {
-    if (opts->print_filename) printf(":");
-    printf("%d\n", match_count);
+    if (opts->print_filename) putc(':', opts->out);
+    fprintf(opts->out, "%zu\n", match_count);
   }
 
   return;
@@ -207,13 +451,14 @@ static void print_final_count(int match_count, const GrepOptions *opts,
 
 static char *process_matches(const char *buffer, GrepOptions *opts,
                              int line_num, const char *filename) {
-  for (size_t i = 0; i < opts->num_regexes; i++) {
+  for (size_t i = 0; i < opts->patterns.count; i++) {
     const char *ptr = buffer;
     regmatch_t match;
-    while (regexec(&opts->regexes[i], ptr, 1, &match, 0) == 0 &&
+    while (exec_pattern(opts, i, ptr, &match) == 0 &&
            match.rm_so != match.rm_eo) {
       handle_match_output(filename, line_num, opts);
-      printf("%.*s\n", (int)(match.rm_eo - match.rm_so), ptr + match.rm_so);
+      fprintf(opts->out, "%.*s\n", (int)(match.rm_eo - match.rm_so),
+              ptr + match.rm_so);
       ptr += match.rm_eo;
     }
   }
@@ -221,31 +466,13 @@ static char *process_matches(const char *buffer, GrepOptions *opts,
 }
 
 static ErrorCode handle_flag_e(GrepOptions *opts, const char *arg) {
-  ErrorCode status = SUCCESS;
-  char **new_ptr = NULL;
-  char *escaped = strdup(arg);
-  if (!escaped) {
-    status = MEMORY_ERROR;
-  } else {
-    new_ptr =
-        realloc(opts->patterns, (opts->num_patterns + 1) * sizeof(char *));
-    if (!new_ptr) {
-      free(escaped);
-      status = MEMORY_ERROR;
-    }
-  }
-
-  if (status == SUCCESS) {
-    opts->patterns = new_ptr;
-    opts->patterns[opts->num_patterns] = escaped;
-    opts->num_patterns++;
-  }
-
+  ErrorCode status = pattern_store_add(&opts->patterns, arg, strlen(arg));
+  if (status != SUCCESS) print_error(opts->program_name, "", "malloc");
   return status;
 }
 
 static ErrorCode read_patterns_from_file(GrepOptions *opts,
-                                         const char *filename) {
+                                         const char *filename, uint64_t route) {
   ErrorCode status = SUCCESS;
 
   FILE *fp = fopen(filename, "r");
@@ -255,10 +482,12 @@ static ErrorCode read_patterns_from_file(GrepOptions *opts,
   } else {
     char *buffer = NULL;
     size_t len = 0;
-    while (getline(&buffer, &len, fp) != -1 && status != FILE_ERROR) {
+    while (getline(&buffer, &len, fp) != -1 && status == SUCCESS) {
       if (!ferror(fp)) {
-        buffer[strcspn(buffer, "\n")] = '\0';
-        status = handle_flag_e(opts, buffer);
+        status = add_pattern(opts, buffer, strcspn(buffer, "\n"), route);
+        if (status == MEMORY_ERROR) {
+          print_error(opts->program_name, "", "malloc");
+        }
       } else {
         print_error(opts->program_name, filename, "Error reading file");
         status = FILE_ERROR;
@@ -271,18 +500,224 @@ static ErrorCode read_patterns_from_file(GrepOptions *opts,
   return status;
 }
 
+static ErrorCode add_pattern(GrepOptions *opts, const char *pattern,
+                             size_t len, uint64_t route) {
+  ErrorCode status = pattern_store_add(&opts->patterns, pattern, len);
+  if (status == SUCCESS && route) {
+    size_t index = pattern_store_find(&opts->patterns, pattern, len);
+    size_t size = opts->patterns.capacity;
+    uint64_t *masks = opts->pattern_routes;
+    if (index >= opts->pattern_routes_size) {
+      masks = realloc(opts->pattern_routes, size * sizeof(uint64_t));
+      if (masks) {
+        memset(masks + opts->pattern_routes_size, 0,
+               (size - opts->pattern_routes_size) * sizeof(uint64_t));
+        opts->pattern_routes = masks;
+        opts->pattern_routes_size = size;
+      }
+    }
+    if (masks) {
+      masks[index] |= route;
+    } else {
+      status = MEMORY_ERROR;
+    }
+  }
+  return status;
+}
+
+static ErrorCode add_route(GrepOptions *opts, char *arg) {
+  ErrorCode status = SUCCESS;
+  char *sep = strchr(arg, '=');
+  if (!sep || sep == arg || !sep[1] || opts->num_routes == ROUTE_MAX) {
+    print_error(opts->program_name, arg,
+                "invalid route (PATTERNFILE=OUT, at most 64 routes)");
+    status = PARSE_FAILURE;
+  } else {
+    GrepRoute *routes =
+        realloc(opts->routes, (opts->num_routes + 1) * sizeof(GrepRoute));
+    if (!routes) {
+      print_error(opts->program_name, "", "malloc");
+      status = MEMORY_ERROR;
+    } else {
+      *sep = '\0';
+      routes[opts->num_routes++] = (GrepRoute){arg, sep + 1, NULL, 0};
+      opts->routes = routes;
+    }
+  }
+  return status;
+}
+
+static ErrorCode load_routes(GrepOptions *opts) {
+  ErrorCode status = SUCCESS;
+  if (opts->patterns.count || opts->count_only || opts->files_with_matches ||
+      opts->output_the_matched || opts->serve_socket || opts->client_socket) {
+    print_error(opts->program_name, "",
+                "--route cannot be combined with -e, -f, -c, -l, -o, "
+                "--serve or --client");
+    status = PARSE_FAILURE;
+  }
+  opts->all_routes = opts->num_routes == ROUTE_MAX
+                         ? UINT64_MAX
+                         : ((uint64_t)1 << opts->num_routes) - 1;
+  for (size_t i = 0; i < opts->num_routes && status == SUCCESS; i++) {
+    status = read_patterns_from_file(opts, opts->routes[i].pattern_file,
+                                     (uint64_t)1 << i);
+  }
+  return status;
+}
+
+static ErrorCode open_routes(GrepOptions *opts) {
+  ErrorCode status = SUCCESS;
+  if (opts->literal_match) {
+    status = ac_set_routes(&opts->automaton, &opts->patterns,
+                           opts->pattern_routes, opts->fold);
+    if (status != SUCCESS) print_error(opts->program_name, "", "malloc");
+  }
+  for (size_t i = 0; i < opts->num_routes && status == SUCCESS; i++) {
+    GrepRoute *route = &opts->routes[i];
+    route->owner = i;
+    for (size_t j = 0; j < i && !route->out; j++) {
+      if (strcmp(opts->routes[j].out_path, route->out_path) == 0) {
+        route->out = opts->routes[j].out;
+        route->owner = j;
+      }
+    }
+    if (!route->out && (route->out = fopen(route->out_path, "a")) != NULL) {
+      setvbuf(route->out, NULL, _IOFBF, ROUTE_BUFFER_SIZE);
+    } else if (!route->out) {
+      print_error(opts->program_name, route->out_path,
+                  "Cannot open output file");
+      status = FILE_ERROR;
+    }
+  }
+  return status;
+}
+
+static uint64_t match_routes(const char *buffer, const GrepOptions *opts) {
+  uint64_t mask = 0;
+  if (opts->literal_match) {
+    mask = ac_match_routes(&opts->automaton, buffer, opts->fold,
+                           opts->all_routes);
+  } else {
+    for (size_t i = 0; i < opts->patterns.count && mask != opts->all_routes;
+         i++) {
+      uint64_t routes = opts->pattern_routes[i];
+      if ((routes & ~mask) && exec_pattern(opts, i, buffer, NULL) == 0) {
+        mask |= routes;
+      }
+    }
+  }
+  return mask;
+}
+
+static void route_line(const char *buffer, int line_num, GrepOptions *opts,
+                       const char *filename) {
+  FILE *out = opts->out;
+  uint64_t matched = match_routes(buffer, opts);
+  uint64_t mask = 0;
+  if (opts->invert_match) matched ^= opts->all_routes;
+  for (size_t i = 0; i < opts->num_routes; i++) {
+    if ((matched >> i) & 1) mask |= (uint64_t)1 << opts->routes[i].owner;
+  }
+  for (size_t i = 0; mask; i++, mask >>= 1) {
+    if (mask & 1) {
+      opts->out = opts->routes[i].out;
+      handle_match_output(filename, line_num, opts);
+      print_plain_line(buffer, opts);
+    }
+  }
+  opts->out = out;
+  return;
+}
+
+static ErrorCode close_routes(GrepOptions *opts) {
+  ErrorCode status = SUCCESS;
+  for (size_t i = 0; i < opts->num_routes; i++) {
+    GrepRoute *route = &opts->routes[i];
+    if (route->out && route->owner == i) {
+      int failed = ferror(route->out);
+      if (fclose(route->out) != 0 || failed) {
+        print_error(opts->program_name, route->out_path,
+                    "Error writing file");
+        status = FILE_ERROR;
+      }
+    }
+  }
+  free(opts->routes);
+  free(opts->pattern_routes);
+  opts->routes = NULL;
+  opts->pattern_routes = NULL;
+  opts->num_routes = opts->pattern_routes_size = 0;
+  return status;
+}
+
+static void setup_matching(GrepOptions *opts) {
+  int literal = 1;
+  int needs_locale = 0;
+  for (size_t i = 0; i < opts->patterns.count; i++) {
+    const char *pattern = pattern_store_get(&opts->patterns, i);
+    literal = literal && is_ascii_literal(pattern);
+    needs_locale = needs_locale || pattern_needs_locale(pattern);
+  }
+
+  opts->literal_match = literal;
+  init_fold_table(opts->fold, opts->ignore_case);
+  if (needs_locale) setlocale(LC_ALL, "");
+
+  return;
+}
+
+static int exec_pattern(const GrepOptions *opts, size_t index,
+                        const char *text, regmatch_t *match) {
+  int rc = REG_NOMATCH;
+  if (opts->literal_match) {
+    const char *pattern = pattern_store_get(&opts->patterns, index);
+    size_t pattern_len = opts->patterns.lengths[index];
+    const char *found =
+        literal_search(text, strlen(text), pattern, pattern_len,
+                       opts->ignore_case ? opts->fold : NULL);
+    if (found) {
+      rc = 0;
+      if (match) {
+        match->rm_so = found - text;
+        match->rm_eo = match->rm_so + pattern_len;
+      }
+    }
+  } else {
+    rc = regexec(&opts->regexes[index], text, match ? 1 : 0, match, 0);
+  }
+  return rc;
+}
+
+static int match_line(const char *buffer, const GrepOptions *opts) {
+  int found = 0;
+  if (opts->use_automaton) {
+    found = ac_match(&opts->automaton, buffer, opts->fold);
+  } else {
+    for (size_t i = 0; i < opts->patterns.count && !found; i++) {
+      found = (exec_pattern(opts, i, buffer, NULL) == 0);
+    }
+  }
+  return found ^ opts->invert_match;
+}
+
 static ErrorCode compile_patterns(GrepOptions *opts) {
-  if (opts->num_patterns == 0) return PARSE_FAILURE;
+  if (opts->patterns.count == 0) return PARSE_FAILURE;
+  if (opts->literal_match) return prepare_automaton(opts);
+  return compile_regexes(opts);
+}
 
+static ErrorCode compile_regexes(GrepOptions *opts) {
   ErrorCode status = SUCCESS;
   int flags = (opts->ignore_case ? REG_ICASE : 0);
-  if (!(opts->regexes = malloc(opts->num_patterns * sizeof(regex_t)))) {
+  if (!(opts->regexes = malloc(opts->patterns.count * sizeof(regex_t)))) {
     print_error(opts->program_name, "", "malloc");
     status = MEMORY_ERROR;
   } else {
     int rc = 0;
-    for (size_t i = 0; i < opts->num_patterns && !rc; i++) {
-      rc = regcomp(&opts->regexes[i], opts->patterns[i], flags);
+    for (size_t i = 0; i < opts->patterns.count && !rc; i++) {
+      rc = regcomp(&opts->regexes[i], pattern_store_get(&opts->patterns, i),
+                   flags);
       if (rc) {
         char errbuf[MAX_ERROR_MSG];
         regerror(rc, &opts->regexes[i], errbuf, sizeof(errbuf));
@@ -297,20 +732,52 @@ static ErrorCode compile_patterns(GrepOptions *opts) {
   return status;
 }
 
+static ErrorCode prepare_automaton(GrepOptions *opts) {
+  ErrorCode status = SUCCESS;
+  char path[4096];
+  uint64_t key = fnv1a_hash(FNV_OFFSET_BASIS, opts->patterns.data,
+                            opts->patterns.data_size);
+  key = fnv1a_hash(key, &opts->ignore_case, sizeof(opts->ignore_case));
+  int cached = opts->patterns.count >= AC_CACHE_MIN_PATTERNS &&
+               automaton_cache_path(path, sizeof(path), key);
+
+  if (!cached || !ac_load(&opts->automaton, path, key, &opts->patterns,
+                          opts->fold)) {
+    status = ac_build(&opts->automaton, &opts->patterns, opts->fold, key);
+    if (status == SUCCESS && cached) ac_save(&opts->automaton, path);
+  }
+  if (status == SUCCESS) {
+    size_t min_patterns =
+        opts->ignore_case ? AC_MIN_PATTERNS_ICASE : AC_MIN_PATTERNS;
+    opts->use_automaton = (opts->patterns.count >= min_patterns);
+  } else {
+    print_error(opts->program_name, "", "malloc");
+  }
+  return status;
+}
+
+static int automaton_cache_path(char *path, size_t size, uint64_t key) {
+  char dir[4096];
+  int ok = cache_dir(CACHE_DIR_ENV, dir, sizeof(dir));
+  if (ok) {
+    ok = snprintf(path, size, "%s/s21_grep-%016llx.ac", dir,
+                  (unsigned long long)key) < (int)size;
+  }
+  return ok;
+}
+
 static void processing_binary(FILE *fp, GrepOptions *opts,
                               const char *filename) {
   size_t size = 1024;
   char buf[size];
   is_binary_file(buf, size, fp, opts, set_grep_binary_flag, filename,
-                 opts->program_name);
+                 opts->program_name, opts->err);
 
   if (opts->binary_file) {
-    int found = 0;
-    for (size_t i = 0; i < opts->num_regexes && !found; i++) {
-      found = (regexec(&opts->regexes[i], buf, 0, NULL, 0) == 0) ^
-              opts->invert_match;
+    if (match_line(buf, opts)) {
+      fprint_error(opts->err, opts->program_name, filename,
+                   "binary file matches");
     }
-    if (found) print_error(opts->program_name, filename, "binary file matches");
   }
 
   return;
@@ -321,13 +788,16 @@ void set_grep_binary_flag(void *opts, int value) {
 }
 
 static void cleanup_resources(GrepOptions *opts) {
-  if (opts->patterns) {
-    for (size_t i = 0; i < opts->num_patterns; i++) {
-      free(opts->patterns[i]);
-    }
-    free(opts->patterns);
-    opts->patterns = NULL;
-  }
+  close_routes(opts);
+  pattern_store_free(&opts->patterns);
+  ac_free(&opts->automaton);
+  opts->use_automaton = 0;
+  free_regexes(opts);
+
+  return;
+}
+
+static void free_regexes(GrepOptions *opts) {
   if (opts->regexes) {
     for (size_t i = 0; i < opts->num_regexes; i++) {
       regfree(&opts->regexes[i]);
@@ -336,15 +806,64 @@ static void cleanup_resources(GrepOptions *opts) {
     opts->regexes = NULL;
     opts->num_regexes = 0;
   }
+  return;
+}
+
+static void print_plain_line(const char *buffer, const GrepOptions *opts) {
+  size_t len = strlen(buffer);
+  fputs(buffer, opts->out);
+  if (!len || buffer[len - 1] != '\n') {
+    putc('\n', opts->out);
+  }
 
   return;
 }
 
-static void print_plain_line(const char *buffer) {
-  printf("%s", buffer);
-  if (buffer[strlen(buffer) - 1] != '\n') {
-    putchar('\n');
+void *grep_serve_worker_begin(const void *opts) {
+  const GrepOptions *shared = opts;
+  GrepOptions *worker = NULL;
+  if (!shared->literal_match && (worker = malloc(sizeof(GrepOptions)))) {
+    *worker = *shared;
+    worker->regexes = NULL;
+    worker->num_regexes = 0;
+    if (compile_regexes(worker) != SUCCESS) {
+      free_regexes(worker);
+      free(worker);
+      worker = NULL;
+    }
   }
+  return worker;
+}
 
+void grep_serve_worker_end(void *worker) {
+  if (worker) {
+    free_regexes(worker);
+    free(worker);
+  }
   return;
-}
\ No newline at end of file
+}
+
+void *grep_serve_begin(const void *opts, void *worker, FILE *out, FILE *err,
+                       size_t num_files) {
+  GrepOptions *request = malloc(sizeof(GrepOptions));
+  if (request) {
+    *request = *(const GrepOptions *)(worker ? worker : opts);
+    request->out = out;
+    request->err = err;
+    request->print_filename =
+        num_files &&
+        ((num_files > 1 && !request->print_without_filename) ||
+         request->files_with_matches);
+  }
+  return request;
+}
+
+void grep_serve_file(void *state, const char *filename, FILE *fp) {
+  process_stream(fp, filename, state);
+  return;
+}
+
+int grep_serve_end(void *state) {
+  free(state);
+  return SUCCESS;
+}
@@ -1,6 +1,10 @@
 #ifndef S21_GREP_H
 #define S21_GREP_H
 
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <getopt.h>
 #include <libgen.h>
 #include <locale.h>
 #include <regex.h>
@@ -9,11 +13,48 @@
 #include <string.h>
 #include <unistd.h>
 
+#include "../common/aho_corasick.h"
+#include "../common/async_reader.h"
+#include "../common/cache_file.h"
 #include "../common/error.h"
 #include "../common/error_codes.h"
 #include "../common/is_binary_file.h"
+#include "../common/literal.h"
+#include "../common/pattern_store.h"
+#include "../common/pipe_reader.h"
+#include "../common/server.h"
 
 #define MAX_ERROR_MSG 256  ///< Максимальная длина сообщения об ошибке regcomp
+#define AC_MIN_PATTERNS 4  ///< Минимум литералов для автомата Ахо-Корасик
+#define AC_MIN_PATTERNS_ICASE 2  ///< То же с -i (свертка замедляет memchr)
+#define AC_CACHE_MIN_PATTERNS 1024  ///< Минимум литералов для файла кэша
+#define CACHE_DIR_ENV "S21_GREP_CACHE_DIR"  ///< Каталог кэша автоматов
+#define SEARCH_WINDOW_SIZE (1024 * 1024)  ///< Размер окна чтения
+#define ROUTE_MAX 64  ///< Максимум маршрутов (--route)
+#define ROUTE_BUFFER_SIZE (256 * 1024)  ///< Буфер вывода маршрута
+
+/**
+ * @brief Коды длинных опций
+ */
+enum {
+  OPT_SERVE = 256,  ///< --serve SOCKET
+  OPT_CLIENT,       ///< --client SOCKET
+  OPT_ROUTE         ///< --route PATTERNFILE=OUT
+};
+
+/**
+ * @brief Маршрут вывода: строки, совпавшие с шаблонами файла, идут в OUT
+ *
+ * Маршруты с одинаковым OUT разделяют один поток, открытый первым из них
+ * (owner); строка, совпавшая с несколькими такими маршрутами, выводится
+ * в этот поток один раз.
+ */
+typedef struct {
+  const char *pattern_file;  ///< Файл шаблонов маршрута
+  const char *out_path;      ///< Файл вывода (дописывается)
+  FILE *out;                 ///< Буферизованный поток вывода
+  size_t owner;              ///< Маршрут, открывший поток вывода
+} GrepRoute;
 
 /**
  * @brief Структура для хранения параметров программы
@@ -21,8 +62,7 @@
 typedef struct {
   regex_t *regexes;  ///< Массив скомпилированных регулярных выражений
   size_t num_regexes;  ///< Количество скомпилированных выражений
-  char **patterns;  ///< Массив строковых шаблонов для поиска
-  size_t num_patterns;  ///< Количество шаблонов
+  PatternStore patterns;  ///< Шаблоны для поиска (арена без дубликатов)
   int ignore_case;  ///< Флаг игнорирования регистра (-i)
   int invert_match;  ///< Флаг инвертирования совпадений (-v)
   int count_only;  ///< Вывод только количества совпадений (-c)
@@ -34,8 +74,41 @@ typedef struct {
   int print_without_filename;  ///< Запрет вывода имени файла (-h)
   const char *program_name;  ///< Имя программы (для вывода ошибок)
   int binary_file;  ///< Флаг бинарного файла
+  int literal_match;  ///< Все шаблоны - ASCII литералы (без regcomp)
+  unsigned char fold[FOLD_TABLE_SIZE];  ///< Таблица свертки регистра (-i)
+  AcAutomaton automaton;  ///< Автомат литералов (и для длинных строк)
+  int use_automaton;      ///< Сопоставление строк через автомат
+  FILE *out;              ///< Поток вывода результатов
+  FILE *err;              ///< Поток вывода ошибок по файлам
+  const char *serve_socket;   ///< Сокет режима сервера (--serve)
+  const char *client_socket;  ///< Сокет режима клиента (--client)
+  GrepRoute *routes;           ///< Маршруты (--route)
+  size_t num_routes;           ///< Количество маршрутов
+  uint64_t all_routes;         ///< Маска всех маршрутов
+  uint64_t *pattern_routes;    ///< Маска маршрутов каждого шаблона
+  size_t pattern_routes_size;  ///< Размер массива масок
 } GrepOptions;
 
+/**
+ * @brief Окно чтения для поиска блоками
+ *
+ * Строка, не поместившаяся в окно, при литеральных шаблонах не копируется:
+ * она подается в автомат частями, и в окне хранится только состояние.
+ */
+typedef struct {
+  char *buffer;        ///< Окно (capacity + 1 байт)
+  size_t capacity;     ///< Размер окна
+  size_t filled;       ///< Заполнено байт
+  size_t match_count;  ///< Количество совпавших строк
+  size_t line_num;     ///< Номер последней обработанной строки
+  int long_line;       ///< Текущая строка длиннее окна
+  uint32_t state;      ///< Состояние автомата для длинной строки
+  int stopped;         ///< В длинной строке встречен '\0'
+  off_t line_start;    ///< Смещение длинной строки (-1 - нет позиции)
+  int done;            ///< Чтение завершено
+  ErrorCode status;    ///< Код ошибки
+} SearchWindow;
+
 /**
  * @brief Обрабатывает аргументы командной строки
  * @param argc Количество аргументов
@@ -62,6 +135,50 @@ static ErrorCode process_flags(int argc, char **argv, GrepOptions *opts);
  */
 static ErrorCode handle_flag_e(GrepOptions *opts, const char *arg);
 
+/**
+ * @brief Выбирает способ сопоставления и при необходимости включает локаль
+ *
+ * Для ASCII шаблонов без '.', скобочных выражений и классов локаль не
+ * загружается, и сопоставление идет побайтово.
+ * @param opts Указатель на структуру параметров
+ */
+static void setup_matching(GrepOptions *opts);
+
+/**
+ * @brief Загружает автомат из кэша или строит и сохраняет его
+ * @param opts Указатель на структуру параметров
+ * @return Код ошибки (ErrorCode)
+ */
+static ErrorCode prepare_automaton(GrepOptions *opts);
+
+/**
+ * @brief Формирует путь к файлу кэша автомата
+ * @param path Буфер для пути
+ * @param size Размер буфера
+ * @param key Ключ кэша
+ * @return 1 если каталог кэша доступен, иначе 0
+ */
+static int automaton_cache_path(char *path, size_t size, uint64_t key);
+
+/**
+ * @brief Сопоставляет один шаблон с текстом
+ * @param opts Указатель на структуру параметров
+ * @param index Индекс шаблона
+ * @param text Строка для поиска
+ * @param match Границы совпадения (может быть NULL)
+ * @return 0 при совпадении, как regexec
+ */
+static int exec_pattern(const GrepOptions *opts, size_t index,
+                        const char *text, regmatch_t *match);
+
+/**
+ * @brief Проверяет, совпадает ли строка хотя бы с одним шаблоном
+ * @param buffer Строка для проверки
+ * @param opts Указатель на структуру параметров
+ * @return 1(true) или 0(false) с учетом флага -v
+ */
+static int match_line(const char *buffer, const GrepOptions *opts);
+
 /**
  * @brief Компилирует регулярные выражения из шаблонов
  * @param opts Указатель на структуру параметров
@@ -70,13 +187,97 @@ static ErrorCode handle_flag_e(GrepOptions *opts, const char *arg);
 static ErrorCode compile_patterns(GrepOptions *opts);
 
 /**
- * @brief Читает шаблоны из файла (флаг -f)
+ * @brief Компилирует шаблоны как регулярные выражения (regcomp)
+ * @param opts Указатель на структуру параметров
+ * @return Код ошибки (ErrorCode)
+ */
+static ErrorCode compile_regexes(GrepOptions *opts);
+
+/**
+ * @brief Освобождает скомпилированные регулярные выражения
+ * @param opts Указатель на структуру параметров
+ */
+static void free_regexes(GrepOptions *opts);
+
+/**
+ * @brief Читает шаблоны из файла (флаг -f или файл маршрута)
  * @param opts Указатель на структуру параметров
  * @param filename Имя файла с шаблонами
+ * @param route Бит маршрута (0 - шаблоны -f)
  * @return Код ошибки (ErrorCode)
  */
 static ErrorCode read_patterns_from_file(GrepOptions *opts,
-                                         const char *filename);
+                                         const char *filename, uint64_t route);
+
+/**
+ * @brief Добавляет шаблон и отмечает его маршрут
+ * @param opts Указатель на структуру параметров
+ * @param pattern Шаблон
+ * @param len Длина шаблона
+ * @param route Бит маршрута (0 - без маршрута)
+ * @return Код ошибки (ErrorCode)
+ */
+static ErrorCode add_pattern(GrepOptions *opts, const char *pattern,
+                             size_t len, uint64_t route);
+
+/**
+ * @brief Разбирает значение --route PATTERNFILE=OUT
+ * @param opts Указатель на структуру параметров
+ * @param arg Значение опции (разделяется на месте)
+ * @return Код ошибки (ErrorCode)
+ */
+static ErrorCode add_route(GrepOptions *opts, char *arg);
+
+/**
+ * @brief Проверяет совместимость флагов и читает шаблоны маршрутов
+ *
+ * Шаблоны всех маршрутов попадают в одно хранилище, поэтому строка
+ * сопоставляется одним автоматом (литералы) или одним проходом по
+ * регулярным выражениям.
+ * @param opts Указатель на структуру параметров
+ * @return Код ошибки (ErrorCode)
+ */
+static ErrorCode load_routes(GrepOptions *opts);
+
+/**
+ * @brief Размечает автомат масками маршрутов и открывает файлы вывода
+ *
+ * Маршруты с одинаковым файлом вывода пишут в один поток.
+ * @param opts Указатель на структуру параметров
+ * @return Код ошибки (ErrorCode)
+ */
+static ErrorCode open_routes(GrepOptions *opts);
+
+/**
+ * @brief Определяет маршруты, шаблоны которых совпали со строкой
+ * @param buffer Строка
+ * @param opts Указатель на структуру параметров
+ * @return Маска совпавших маршрутов
+ */
+static uint64_t match_routes(const char *buffer, const GrepOptions *opts);
+
+/**
+ * @brief Выводит строку в файлы совпавших маршрутов (с -v - несовпавших)
+ *
+ * Совпавшие маршруты сводятся к маске владельцев потоков, поэтому в общий
+ * файл вывода строка пишется один раз.
+ * @param buffer Строка
+ * @param line_num Номер строки
+ * @param opts Указатель на структуру параметров
+ * @param filename Имя файла
+ */
+static void route_line(const char *buffer, int line_num, GrepOptions *opts,
+                       const char *filename);
+
+/**
+ * @brief Сбрасывает и закрывает файлы вывода маршрутов
+ *
+ * Ошибка записи (в том числе при сбросе буфера, например ENOSPC)
+ * означает потерю строк маршрута и возвращается как FILE_ERROR.
+ * @param opts Указатель на структуру параметров
+ * @return Код ошибки
+ */
+static ErrorCode close_routes(GrepOptions *opts);
 
 /**
  * @brief Освобождает выделенные ресурсы
@@ -91,6 +292,121 @@ static void cleanup_resources(GrepOptions *opts);
  */
 static void process_file(const char *filename, GrepOptions *opts);
 
+/**
+ * @brief Обрабатывает файлы из аргументов через конвейер чтения
+ *
+ * Файлы открываются и читаются заранее через io_uring (см. async_reader.h)
+ * и обрабатываются из памяти в порядке аргументов.
+ * @param num_files Количество файлов
+ * @param files Имена файлов
+ * @param opts Указатель на структуру параметров
+ */
+static void process_files(int num_files, char **files, GrepOptions *opts);
+
+/**
+ * @brief Обрабатывает открытый поток
+ * @param fp Указатель на файл или NULL, если файл не открылся
+ * @param filename Имя файла или "(standard input)"
+ * @param opts Указатель на структуру параметров
+ */
+static void process_stream(FILE *fp, const char *filename, GrepOptions *opts);
+
+/**
+ * @brief Выбирает поиск блоками вместо построчного getline
+ *
+ * Блоками обрабатываются -c, -l и вывод строк для литеральных шаблонов
+ * (кроме -o и --route); память ограничена окном SEARCH_WINDOW_SIZE для
+ * литералов, кроме вывода совпавших строк длиннее окна из канала.
+ * @param opts Указатель на структуру параметров
+ * @return 1(true) или 0(false)
+ */
+static int use_block_search(const GrepOptions *opts);
+
+/**
+ * @brief Поиск блоками без построчного копирования
+ *
+ * Поток читается окнами; целые строки обрабатываются прямо в окне. Для
+ * -c и -l с литералами совпадения считаются по всему блоку, а для -v
+ * результат равен количеству строк минус количество совпадений. С -l
+ * чтение прекращается после первого совпадения.
+ * @param file Указатель на файл
+ * @param opts Указатель на структуру параметров
+ * @param filename Имя файла
+ */
+static void block_search(FILE *file, GrepOptions *opts, const char *filename);
+
+/**
+ * @brief Обрабатывает целые строки окна, начиная со смещения
+ * @param win Окно чтения
+ * @param offset Смещение первой строки
+ * @param opts Указатель на структуру параметров
+ * @param filename Имя файла
+ * @return Количество обработанных байт
+ */
+static size_t search_lines(SearchWindow *win, size_t offset,
+                           GrepOptions *opts, const char *filename);
+
+/**
+ * @brief Считает совпавшие строки в блоке литералами
+ *
+ * Набор литералов всегда считается автоматом, независимо от
+ * AC_MIN_PATTERNS: сумма счетчиков отдельных литералов учла бы строку с
+ * несколькими совпадениями несколько раз.
+ * @param text Блок целых строк
+ * @param len Длина блока
+ * @param opts Указатель на структуру параметров
+ * @return Количество строк, совпавших с учетом -v
+ */
+static size_t count_block(const char *text, size_t len,
+                          const GrepOptions *opts);
+
+/**
+ * @brief Обрабатывает строку, заполнившую все окно
+ *
+ * Для литералов строка переводится в потоковый режим, если ее не нужно
+ * выводить (-c, -l) или ее можно перечитать из файла для вывода. Иначе (в
+ * том числе для литералов из канала) окно увеличивается вдвое, и строка
+ * любой длины обрабатывается целиком, как при построчном чтении.
+ * @param win Окно чтения
+ * @param file Указатель на файл
+ * @param opts Указатель на структуру параметров
+ * @param filename Имя файла
+ */
+static void extend_window(SearchWindow *win, FILE *file, GrepOptions *opts,
+                          const char *filename);
+
+/**
+ * @brief Подает в автомат продолжение длинной строки из окна
+ * @param win Окно чтения
+ * @param file Указатель на файл
+ * @param opts Указатель на структуру параметров
+ * @param filename Имя файла
+ * @return Количество обработанных байт (вместе с '\n')
+ */
+static size_t feed_long_line(SearchWindow *win, FILE *file,
+                             GrepOptions *opts, const char *filename);
+
+/**
+ * @brief Выводит совпавшую длинную строку, перечитывая ее из файла
+ *
+ * Потоковый режим выбирается только для потоков с позиционированием;
+ * если перейти к началу строки все же не удалось, печатается сообщение о
+ * превышении размера окна.
+ * @param win Окно чтения
+ * @param file Указатель на файл
+ * @param opts Указатель на структуру параметров
+ * @param filename Имя файла
+ */
+static void print_long_line(const SearchWindow *win, FILE *file,
+                            const GrepOptions *opts, const char *filename);
+
+/**
+ * @brief Проверяет, можно ли сопоставлять литералы прямо в блоке
+ * @param opts Указатель на структуру параметров
+ * @return 1(true) или 0(false)
+ */
+static int can_count_raw(const GrepOptions *opts);
+
 /**
  * @brief Выводит префикс строки (имя файла/номер строки)
  * @param filename Имя файла
@@ -117,7 +433,7 @@ static void process_line(const char *buffer, int line_num, GrepOptions *opts,
  * @param opts Указатель на структуру параметров
  * @param filename Имя файла
  */
-static void print_final_count(int match_count, const GrepOptions *opts,
+static void print_final_count(size_t match_count, const GrepOptions *opts,
                               const char *filename);
 
 /**
@@ -151,8 +467,9 @@ static char *process_matches(const char *buffer, GrepOptions *opts,
 /**
  * @brief Выводит строку без модификаций
  * @param buffer Строка для вывода
+ * @param opts Указатель на структуру параметров
  */
-static void print_plain_line(const char *buffer);
+static void print_plain_line(const char *buffer, const GrepOptions *opts);
 
 /**
  * @brief Устанавливает флаг бинарного файла
@@ -161,4 +478,49 @@ static void print_plain_line(const char *buffer);
  */
 void set_grep_binary_flag(void *opts, int value);
 
+/**
+ * @brief Запуск рабочего потока сервера (Callback)
+ *
+ * regexec glibc захватывает блокировку внутри regex_t, поэтому общий набор
+ * выражений выполнял бы запросы потоков по очереди. Каждый поток получает
+ * собственные копии выражений; литеральные шаблоны (автомат и
+ * literal_search) только читаются и остаются общими.
+ * @param opts Общая структура параметров
+ * @return Параметры потока с его выражениями или NULL (общие параметры)
+ */
+void *grep_serve_worker_begin(const void *opts);
+
+/**
+ * @brief Остановка рабочего потока сервера (Callback)
+ * @param worker Параметры потока или NULL
+ */
+void grep_serve_worker_end(void *worker);
+
+/**
+ * @brief Начало запроса в режиме сервера (Callback)
+ * @param opts Общая структура параметров
+ * @param worker Параметры рабочего потока или NULL
+ * @param out Поток вывода клиента
+ * @param err Поток ошибок клиента
+ * @param num_files Количество файлов в запросе
+ * @return Копия параметров для запроса или NULL
+ */
+void *grep_serve_begin(const void *opts, void *worker, FILE *out, FILE *err,
+                       size_t num_files);
+
+/**
+ * @brief Обработка файла запроса в режиме сервера (Callback)
+ * @param state Параметры запроса
+ * @param filename Имя файла
+ * @param fp Указатель на файл или NULL
+ */
+void grep_serve_file(void *state, const char *filename, FILE *fp);
+
+/**
+ * @brief Завершение запроса в режиме сервера (Callback)
+ * @param state Параметры запроса
+ * @return Код завершения для клиента
+ */
+int grep_serve_end(void *state);
+
 #endif  // S21_GREP_H
\ No newline at end of file